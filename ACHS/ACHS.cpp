@@ -3,6 +3,10 @@
 #include <fstream>
 #include <iomanip>
 #include <chrono>
+#include <functional>
+#include <mutex>
+#include <sstream>
+#include <thread>
 
 // Helper to construct curves more easily
 #include "TreasuryQuote.h"
@@ -11,13 +15,19 @@
 #include "ExtensionMethod.h"
 #include "ExtendedCurve.h"
 #include "ExtendedCurves.h"
+#include "Valuation.h"
+#include "Immunization.h"
 
-// Extension methods
-#include "Constant.h"
-#include "Flat.h"
-#include "LinearlyGraded.h"
-#include "RollingAverage.h"
-#include "DualBlended.h"
+// Concurrent execution
+#include "Pipeline.h"
+
+// Curve sets shared with worker processes
+#if !defined(_WIN32)
+#include "CurveServer.h"
+#endif
+
+// Market, base curves and extension methods shared with the benchmarks
+#include "CurveSetup.h"
 
 // LCF generation
 #include "LiabilityCashFlows.h"
@@ -26,200 +36,265 @@
 using namespace QuantLib;
 using namespace ACHS;
 
-std::shared_ptr<Bond> makeBond(const Date& today, const Period& tenor, Rate coupon = 0.05) {
-    Calendar calendar = UnitedStates(UnitedStates::GovernmentBond);
-    Date maturity = calendar.advance(today, tenor);
-    Schedule schedule(today, maturity, Period(Semiannual), calendar,
-        Unadjusted, Unadjusted, DateGeneration::Backward, false);
-    return std::make_shared<FixedRateBond>(
-        1, 100.0, schedule, std::vector<Rate>{coupon}, ActualActual(ActualActual::Bond));
-}
-
-int main() {
+// ACHS [--publish <name> | --attach <name> | --unlink <name>]
+//
+// --publish builds and values the curves as usual, then publishes them to the POSIX shared-memory curve
+// server <name> (e.g. /achs). --attach values against the curves last published there instead of building
+// them. --unlink removes the server's shared-memory segments.
+int main(int argc, char* argv[]) {
     std::cout << "ACHS Surplus Volatility\nHarold James Krause\n05-19-2025\n\n";
 
+    std::string mode = argc > 1 ? argv[1] : "";
+    std::string server = argc > 2 ? argv[2] : "";
+    if (argc > 3 || (!mode.empty() && ((mode != "--publish" && mode != "--attach" && mode != "--unlink") || server.empty()))) {
+        std::cerr << "Usage: ACHS [--publish <name> | --attach <name> | --unlink <name>]\n";
+        return 1;
+    }
+#if defined(_WIN32)
+    if (!mode.empty()) {
+        std::cerr << "Shared-memory curve servers require POSIX.\n";
+        return 1;
+    }
+#else
+    if (mode == "--unlink") {
+        CurvePublisher::unlink(server);
+        return 0;
+    }
+#endif
+    bool attach = mode == "--attach";
+
     Date today(31, Dec, 2024);
 
     Settings::instance().evaluationDate() = today;
 
-    std::vector<TreasuryQuote> treasury_quotes = {
-        TreasuryQuote(100.0000, 4.2275, Period(1, Months)),
-        TreasuryQuote(100.0000, 4.2225, Period(2, Months)),
-        TreasuryQuote(100.0000, 4.2150, Period(3, Months)),
-        TreasuryQuote(100.0000, 4.2150, Period(4, Months)),
-        TreasuryQuote(100.0000, 4.0575, Period(6, Months)),
-        TreasuryQuote(100.0000, 3.8575, Period(1, Years)),
-        TreasuryQuote(100.0898, 3.8750, Period(2, Years)),
-        TreasuryQuote(099.7695, 3.7500, Period(3, Years)),
-        TreasuryQuote(100.1953, 4.0000, Period(5, Years)),
-        TreasuryQuote(100.0078, 4.1250, Period(7, Years)),
-        TreasuryQuote(102.4688, 4.6250, Period(10, Years)),
-        TreasuryQuote(100.0000, (4.6250 + 4.7500) / 2.0, Period(15, Years)),    //synthetic
-        TreasuryQuote(099.3281, 4.7500, Period(20, Years)),
-        TreasuryQuote(100.0000, (4.75 + 4.625) / 2.0, Period(25, Years)),       //synthetic
-        TreasuryQuote(097.7500, 4.6250, Period(30, Years)) };                   // base quote is 4.625% par
-
-    
-    std::vector<std::shared_ptr<RateHelper>> rate_helpers;
-    std::vector<std::shared_ptr<BondHelper>> bond_helpers;
-    for (const TreasuryQuote& quote : treasury_quotes) {
-        rate_helpers.push_back(quote.makeHelper<RateHelper>());
-        bond_helpers.push_back(quote.makeHelper<BondHelper>());
-    }
-
     DayCounter dc = ActualActual(ActualActual::Actual365);
-    Calendar calendar = UnitedStates(UnitedStates::GovernmentBond);
-
-    std::vector<std::pair<std::string, std::shared_ptr<YieldTermStructure>>> base_yield_curves{
-        {"PIECEWISE_ZERO_LINEAR", std::make_shared<PiecewiseYieldCurve<ZeroYield, Linear>>(today, rate_helpers, dc)},
-        {"PIECEWISE_DISCOUNT_LOGLINEAR", std::make_shared<PiecewiseYieldCurve<Discount, LogLinear>>(today, rate_helpers, dc)},
-        {"PIECEWISE_ZERO_CUBIC", std::make_shared<PiecewiseYieldCurve<ZeroYield, Cubic>>(today, rate_helpers, dc)},
-        {"FITTED_NELSON_SIEGEL", std::make_shared<FittedBondDiscountCurve>(0, calendar, bond_helpers, dc, NelsonSiegelFitting())},
-        {"FITTED_NELSON_SIEGEL_SVENSSON", std::make_shared<FittedBondDiscountCurve>(0, calendar, bond_helpers, dc, SvenssonFitting())},
-        {"FITTED_EXPONENTIAL_SPLINES", std::make_shared<FittedBondDiscountCurve>(0, calendar, bond_helpers, dc, ExponentialSplinesFitting())}
-    };
 
+    std::vector<std::pair<std::string, BaseFactory>> base_yield_curves = baseFactories(treasuryQuotes(), today);
+    std::vector<std::pair<std::string, Extension>> extension_methods = extensionMethods();
+
+    // QuantLib's observer graph is not thread-safe, so QuantLib objects are built, linked, unlinked and
+    // destroyed under this lock; bootstraps and valuations of already built curves run outside it. A base is
+    // owned by base_curves until it is extended and then by its extended curves, which stay in curves until
+    // they are valued, or until main returns if --publish needs them. The copies handed between stages are
+    // moved on or dropped under the lock, so they are never the last reference.
+    std::mutex quantlib_mutex;
+    std::vector<std::shared_ptr<YieldTermStructure>> base_curves(base_yield_curves.size());
+    bool publish = mode == "--publish";
+
+    // Frozen: curves are detached from the observer graph as they are added, so valuation touches no
+    // shared QuantLib state
+    Spread spread = 0.001;
+    ExtendedCurves curves(spread);
+    curves.freeze();
+
+    // Instruments are shared read-only by the valuation workers
+    LiabilityCashFlows liability_cash_flows("liability_cash_flows.csv");
 
-    ExtendedCurves yield_curves(0.001);
-    for (const std::pair<std::string, std::shared_ptr<YieldTermStructure>>& base : base_yield_curves) {
-        // Forward-rate extensions
-        yield_curves.addOrUpdate(base.first + ":FLAT_FORWARD", base.second, Flat<Traits::Forward>(Period(30, Years), Period(100, Years)));
-        yield_curves.addOrUpdate(base.first + ":CONSTANT_FORWARD", base.second, Constant<Traits::Forward>(Rate(0.05), Period(30, Years), Period(100, Years)));
-        yield_curves.addOrUpdate(base.first + ":LINEARLY_GRADED_FORWARD", base.second, LinearlyGraded<Traits::Forward>(Rate(0.05), Period(30, Years), Period(40, Years), Period(100, Years)));
-        yield_curves.addOrUpdate(base.first + ":ROLLING_AVERAGE_FORWARD", base.second, RollingAverage<Traits::Forward>(60, Period(30, Years), Period(100, Years)));
-        yield_curves.addOrUpdate(base.first + ":DUAL_BLENDED_FORWARD", base.second, DualBlended<Traits::Forward>(Period(30, Years), Period(100, Years)));
-        // Zero-rate extensions
-        yield_curves.addOrUpdate(base.first + ":FLAT_ZERO", base.second, Flat<Traits::Zero>(Period(30, Years), Period(100, Years)));
-        yield_curves.addOrUpdate(base.first + ":CONSTANT_ZERO", base.second, Constant<Traits::Zero>(Rate(0.05), Period(30, Years), Period(100, Years)));
-        yield_curves.addOrUpdate(base.first + ":LINEARLY_GRADED_ZERO", base.second, LinearlyGraded<Traits::Zero>(Rate(0.05), Period(30, Years), Period(40, Years), Period(100, Years)));
-        yield_curves.addOrUpdate(base.first + ":ROLLING_AVERAGE_ZERO", base.second, RollingAverage<Traits::Zero>(60, Period(30, Years), Period(100, Years)));
-        yield_curves.addOrUpdate(base.first + ":DUAL_BLENDED_ZERO", base.second, DualBlended<Traits::Forward>(Period(30, Years), Period(100, Years)));
+    std::vector<Period> tenors = { Period(5, Years), Period(10, Years), Period(20, Years), Period(30, Years) };
+    std::vector<std::shared_ptr<Bond>> bonds;
+    for (const auto& tenor : tenors) {
+        bonds.push_back(makeBond(today, tenor));
     }
-    
-
-    std::vector<std::string> yield_curve_names{
-        "PIECEWISE_ZERO_LINEAR:FLAT_FORWARD",
-        "PIECEWISE_ZERO_LINEAR:CONSTANT_FORWARD",
-        "PIECEWISE_ZERO_LINEAR:LINEARLY_GRADED_FORWARD",
-        "PIECEWISE_ZERO_LINEAR:ROLLING_AVERAGE_FORWARD",
-        "PIECEWISE_ZERO_LINEAR:DUAL_BLENDED_FORWARD",
-
-        "PIECEWISE_ZERO_LINEAR:FLAT_ZERO",
-        "PIECEWISE_ZERO_LINEAR:CONSTANT_ZERO",
-        "PIECEWISE_ZERO_LINEAR:LINEARLY_GRADED_ZERO",
-        "PIECEWISE_ZERO_LINEAR:ROLLING_AVERAGE_ZERO",
-        "PIECEWISE_ZERO_LINEAR:DUAL_BLENDED_ZERO",
-
-        "PIECEWISE_DISCOUNT_LOGLINEAR:FLAT_FORWARD",
-        "PIECEWISE_DISCOUNT_LOGLINEAR:CONSTANT_FORWARD",
-        "PIECEWISE_DISCOUNT_LOGLINEAR:LINEARLY_GRADED_FORWARD",
-        "PIECEWISE_DISCOUNT_LOGLINEAR:ROLLING_AVERAGE_FORWARD",
-        "PIECEWISE_DISCOUNT_LOGLINEAR:DUAL_BLENDED_FORWARD",
-
-        "PIECEWISE_DISCOUNT_LOGLINEAR:FLAT_ZERO",
-        "PIECEWISE_DISCOUNT_LOGLINEAR:CONSTANT_ZERO",
-        "PIECEWISE_DISCOUNT_LOGLINEAR:LINEARLY_GRADED_ZERO",
-        "PIECEWISE_DISCOUNT_LOGLINEAR:ROLLING_AVERAGE_ZERO",
-        "PIECEWISE_DISCOUNT_LOGLINEAR:DUAL_BLENDED_ZERO",
-
-        "PIECEWISE_ZERO_CUBIC:FLAT_FORWARD",
-        "PIECEWISE_ZERO_CUBIC:CONSTANT_FORWARD",
-        "PIECEWISE_ZERO_CUBIC:LINEARLY_GRADED_FORWARD",
-        "PIECEWISE_ZERO_CUBIC:ROLLING_AVERAGE_FORWARD",
-        "PIECEWISE_ZERO_CUBIC:DUAL_BLENDED_FORWARD",
-
-        "PIECEWISE_ZERO_CUBIC:FLAT_ZERO",
-        "PIECEWISE_ZERO_CUBIC:CONSTANT_ZERO",
-        "PIECEWISE_ZERO_CUBIC:LINEARLY_GRADED_ZERO",
-        "PIECEWISE_ZERO_CUBIC:ROLLING_AVERAGE_ZERO",
-        "PIECEWISE_ZERO_CUBIC:DUAL_BLENDED_ZERO",
-
-        "FITTED_NELSON_SIEGEL:FLAT_FORWARD",
-        "FITTED_NELSON_SIEGEL:CONSTANT_FORWARD",
-        "FITTED_NELSON_SIEGEL:LINEARLY_GRADED_FORWARD",
-        "FITTED_NELSON_SIEGEL:ROLLING_AVERAGE_FORWARD",
-        "FITTED_NELSON_SIEGEL:DUAL_BLENDED_FORWARD",
-
-        "FITTED_NELSON_SIEGEL:FLAT_ZERO",
-        "FITTED_NELSON_SIEGEL:CONSTANT_ZERO",
-        "FITTED_NELSON_SIEGEL:LINEARLY_GRADED_ZERO",
-        "FITTED_NELSON_SIEGEL:ROLLING_AVERAGE_ZERO",
-        "FITTED_NELSON_SIEGEL:DUAL_BLENDED_ZERO",
-
-        "FITTED_NELSON_SIEGEL_SVENSSON:FLAT_FORWARD",
-        "FITTED_NELSON_SIEGEL_SVENSSON:CONSTANT_FORWARD",
-        "FITTED_NELSON_SIEGEL_SVENSSON:LINEARLY_GRADED_FORWARD",
-        "FITTED_NELSON_SIEGEL_SVENSSON:ROLLING_AVERAGE_FORWARD",
-        "FITTED_NELSON_SIEGEL_SVENSSON:DUAL_BLENDED_FORWARD",
-
-        "FITTED_NELSON_SIEGEL_SVENSSON:FLAT_ZERO",
-        "FITTED_NELSON_SIEGEL_SVENSSON:CONSTANT_ZERO",
-        "FITTED_NELSON_SIEGEL_SVENSSON:LINEARLY_GRADED_ZERO",
-        "FITTED_NELSON_SIEGEL_SVENSSON:ROLLING_AVERAGE_ZERO",
-        "FITTED_NELSON_SIEGEL_SVENSSON:DUAL_BLENDED_ZERO",
-
-        "FITTED_EXPONENTIAL_SPLINES:FLAT_FORWARD",
-        "FITTED_EXPONENTIAL_SPLINES:CONSTANT_FORWARD",
-        "FITTED_EXPONENTIAL_SPLINES:LINEARLY_GRADED_FORWARD",
-        "FITTED_EXPONENTIAL_SPLINES:ROLLING_AVERAGE_FORWARD",
-        "FITTED_EXPONENTIAL_SPLINES:DUAL_BLENDED_FORWARD",
-
-        "FITTED_EXPONENTIAL_SPLINES:FLAT_ZERO",
-        "FITTED_EXPONENTIAL_SPLINES:CONSTANT_ZERO",
-        "FITTED_EXPONENTIAL_SPLINES:LINEARLY_GRADED_ZERO",
-        "FITTED_EXPONENTIAL_SPLINES:ROLLING_AVERAGE_ZERO",
-        "FITTED_EXPONENTIAL_SPLINES:DUAL_BLENDED_ZERO"
-    };
 
     std::ofstream curve_out("yield_curves.csv");
     curve_out << "CurveName,Date,ForwardRate\n";
 
-    for (const auto& name : yield_curve_names) {
-        yield_curves.setActiveCurve(name);
-        auto curve = yield_curves.activeCurve();
-        Date ref = today;
+    std::ofstream liab_out("liabilities_base_curves.csv");
+    liab_out << "CurveName,NPV,Duration,Convexity\n";
+
+    std::ofstream bond_out("assets_base_curves.csv");
+    bond_out << "CurveName,Tenor,NPV,Duration,Convexity\n";
+
+    // Each curve flows bootstrap -> extend -> value -> write as soon as its base is ready. Curves are
+    // numbered base-major, in registration order, and the writer restores that order
+    struct BaseJob {
+        Size base;
+        BaseFactory factory;
+    };
+    struct BuiltBase {
+        Size base;
+        std::shared_ptr<YieldTermStructure> curve;
+    };
+    struct BuiltCurve {
+        Size sequence;
+        std::string name;
+        CurveRegistry::Entry entry;
+    };
+    struct ValuedCurve {
+        Size sequence;
+        std::string curve_rows;
+        std::string bond_rows;
+        std::string liability_row;
+    };
+
+    Size bases = base_yield_curves.size();
+    Size methods = extension_methods.size();
+    Size curve_count = bases * methods;
+
+    // Attached curves are prebuilt views of the published node grids, numbered in publication order
+#if !defined(_WIN32)
+    std::shared_ptr<const SharedCurveSet> published;
+    if (attach) {
+        published = CurveSubscriber(server, dc).attach();
+        published->loadInto(curves);
+        curve_count = published->size();
+        std::cout << "Attached to version " << published->version() << " of " << server << "\n";
+    }
+#endif
+    Size hardware = std::max<Size>(std::thread::hardware_concurrency(), 2);
+
+    BoundedQueue<BaseJob> base_jobs(bases);
+    BoundedQueue<BuiltBase> built_bases(bases);
+    BoundedQueue<BuiltCurve> built_curves(methods);
+    BoundedQueue<ValuedCurve> valued_curves(2 * methods);
+
+    // Extension runs under the QuantLib lock, so one worker suffices
+    Size bootstrap_workers = bases;
+    Size extend_workers = 1;
+    Size value_workers = hardware;
+    Size write_workers = 1;
+
+    // Asset and liability sensitivities on every curve, filled by the valuation workers for the immunization
+    SensitivityMatrix sensitivities(bonds, liability_cash_flows.leg(), curve_count);
+
+    ThreadPool pool(bootstrap_workers + extend_workers + value_workers + write_workers);
+    Pipeline pipeline(pool);
+
+    auto bootstrap = [&](BaseJob job, auto& emit) {
+        std::shared_ptr<YieldTermStructure> curve;
+        {
+            std::lock_guard<std::mutex> lock(quantlib_mutex);
+            curve = job.factory();
+            curve->enableExtrapolation();
+            base_curves[job.base] = curve;
+        }
+        // Bootstrap or fit outside the lock; the market is fixed, so freeze the result
+        curve->discount(0.0);
+        if (auto lazy = std::dynamic_pointer_cast<LazyObject>(curve)) {
+            lazy->freeze();
+        }
+        emit(BuiltBase{ job.base, std::move(curve) });
+    };
+
+    auto extend = [&](BuiltBase built, auto& emit) {
+        for (Size m = 0; m < methods; ++m) {
+            std::string name = base_yield_curves[built.base].first + ":" + extension_methods[m].first;
+            CurveRegistry::Entry entry;
+            {
+                std::lock_guard<std::mutex> lock(quantlib_mutex);
+                curves.addOrUpdate(name, extension_methods[m].second(built.curve));
+                entry = curves.registry().at(*curves.registry().find(name));
+            }
+            emit(BuiltCurve{ built.base * methods + m, name, std::move(entry) });
+        }
+
+        // The extended curves now own the base
+        std::lock_guard<std::mutex> lock(quantlib_mutex);
+        base_curves[built.base].reset();
+        built.curve.reset();
+    };
 
+    // Attached curves skip bootstrap and extension and enter the pipeline at valuation
+    if (!attach) {
+        pipeline.stage(base_jobs, built_bases, bootstrap_workers, bootstrap);
+        pipeline.stage(built_bases, built_curves, extend_workers, extend);
+    }
+
+    pipeline.stage(built_curves, valued_curves, value_workers, [&](BuiltCurve built, auto& emit) {
+        const YieldTermStructure& curve = *built.entry.curve;
+
+        std::ostringstream curve_rows;
+        curve_rows << std::fixed << std::setprecision(6);
         for (int m = 1; m <= 70 * 12; ++m) {
-            Date start = ref + Period(m - 1, Months);
-            Date end = ref + Period(m, Months);
+            Date start = today + Period(m - 1, Months);
+            Date end = today + Period(m, Months);
             try {
-                Rate fwd = curve->forwardRate(start, end, dc, Continuous).rate();
-                curve_out << name << "," << io::iso_date(end) << "," << std::fixed << std::setprecision(6) << fwd << "\n";
+                Rate fwd = curve.forwardRate(start, end, dc, Continuous).rate();
+                curve_rows << built.name << "," << io::iso_date(end) << "," << fwd << "\n";
             }
             catch (...) {
                 // Protect from silly extrapolation errors
             }
         }
-    }
-    curve_out.close();
 
-    LiabilityCashFlows liability_cash_flows("liability_cash_flows.csv");
-    std::ofstream liab_out("liabilities_base_curves.csv");
-    liab_out << "CurveName,NPV,Duration,Convexity\n";
+        std::ostringstream bond_rows;
+        bond_rows << std::fixed << std::setprecision(6);
+        for (Size b = 0; b < bonds.size(); ++b) {
+            auto [npv, up, down] = shiftedValues(*bonds[b], built.entry);
+            bond_rows << built.name << "," << tenors[b].length() << " " << tenors[b].units() << ","
+                << npv << "," << effectiveDuration(npv, up, down, spread) << "," << effectiveConvexity(npv, up, down, spread) << "\n";
+        }
 
-    std::ofstream bond_out("assets_base_curves.csv");
-    bond_out << "CurveName,Tenor,NPV,Duration,Convexity\n";
+        const Leg& leg = liability_cash_flows.leg();
+        auto [npv, up, down] = shiftedValues(leg, built.entry);
+        std::ostringstream liability_row;
+        liability_row << std::fixed << std::setprecision(6) << built.name << "," << npv << ","
+            << effectiveDuration(npv, up, down, spread) << "," << effectiveConvexity(npv, up, down, spread) << "\n";
 
-    std::vector<Period> tenors = { Period(5, Years), Period(10, Years), Period(20, Years), Period(30, Years) };
+        sensitivities.setCurve(built.sequence, curve);
+
+        emit(ValuedCurve{ built.sequence, curve_rows.str(), bond_rows.str(), liability_row.str() });
 
-    for (const auto& name : yield_curve_names) {
-        yield_curves.setActiveCurve(name);
-        for (const auto& tenor : tenors) {
-            auto bond = makeBond(today, tenor);
-            yield_curves.linkToActiveCurve(bond);
-            Real npv = yield_curves.NPV(bond);
-            Real dur = yield_curves.duration(bond);
-            Real con = yield_curves.convexity(bond);
-            bond_out << name << "," << tenor.length() << " " << tenor.units() << ","
-                << std::fixed << std::setprecision(6) << npv << "," << dur << "," << con << "\n";
+        // Once its record is emitted, only --publish needs the curve
+        std::lock_guard<std::mutex> lock(quantlib_mutex);
+        if (!publish) {
+            curves.remove(built.name);
+        }
+        built.entry = CurveRegistry::Entry();
+    });
+
+    // Curves finish out of order; hold early arrivals until their predecessors are written
+    std::map<Size, ValuedCurve> pending;
+    Size next = 0;
+    pipeline.sink(valued_curves, write_workers, [&](ValuedCurve valued) {
+        pending.emplace(valued.sequence, std::move(valued));
+        for (auto it = pending.find(next); it != pending.end(); it = pending.find(++next)) {
+            curve_out << it->second.curve_rows;
+            bond_out << it->second.bond_rows;
+            liab_out << it->second.liability_row;
+            pending.erase(it);
+        }
+    });
+
+    if (attach) {
+#if !defined(_WIN32)
+        const CurveRegistry& registry = curves.registry();
+        for (Size i = 0; i < published->size(); ++i) {
+            built_curves.push(BuiltCurve{ i, published->name(i), registry.at(*registry.find(published->name(i))) });
+        }
+#endif
+        built_curves.close();
+    }
+    else {
+        for (Size b = 0; b < bases; ++b) {
+            base_jobs.push(BaseJob{ b, base_yield_curves[b].second });
         }
-        Real npv = yield_curves.NPV(liability_cash_flows.leg());
-        Real dur = yield_curves.duration(liability_cash_flows.leg());
-        Real con = yield_curves.convexity(liability_cash_flows.leg());
-        liab_out << name << "," << std::fixed << std::setprecision(6) << npv << "," << dur << "," << con << "\n";
+        base_jobs.close();
     }
+    pipeline.wait();
+
+#if !defined(_WIN32)
+    if (publish) {
+        std::uint64_t version = CurvePublisher(server, dc).publish(curves);
+        std::cout << "Published version " << version << " of " << server << "\n";
+    }
+#endif
+
+    curve_out.close();
     bond_out.close();
     liab_out.close();
 
+    // Bond holdings matching the liabilities' value, duration and convexity across all curves at once
+    ImmunizationResult immunization = immunize(sensitivities);
+    if (!immunization.converged) {
+        std::cerr << "Immunization did not converge in " << immunization.sweeps << " sweeps; weights are the last iterate.\n";
+    }
+    std::ofstream hedge_out("immunization.csv");
+    hedge_out << "Tenor,Weight\n";
+    for (Size b = 0; b < bonds.size(); ++b) {
+        hedge_out << tenors[b].length() << " " << tenors[b].units() << "," << std::fixed << std::setprecision(6) << immunization.weights[b] << "\n";
+    }
+    hedge_out.close();
+
     return 0;
 }
\ No newline at end of file
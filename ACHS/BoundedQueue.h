@@ -0,0 +1,63 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <optional>
+namespace ACHS {
+
+	// Blocking multi-producer, multi-consumer queue with a fixed capacity. push blocks while the queue is full
+	// and pop blocks while it is empty. Once closed, pushes fail and pops drain the remaining items; once
+	// cancelled, remaining items are discarded as well.
+	template<typename T>
+	class BoundedQueue {
+	public:
+		explicit BoundedQueue(std::size_t capacity) : capacity_(capacity == 0 ? 1 : capacity) {}
+
+		bool push(T item) {
+			std::unique_lock<std::mutex> lock(mutex_);
+			not_full_.wait(lock, [this]() { return items_.size() < capacity_ || closed_; });
+			if (closed_) {
+				return false;
+			}
+			items_.push_back(std::move(item));
+			not_empty_.notify_one();
+			return true;
+		}
+
+		std::optional<T> pop() {
+			std::unique_lock<std::mutex> lock(mutex_);
+			not_empty_.wait(lock, [this]() { return !items_.empty() || closed_; });
+			if (items_.empty()) {
+				return std::nullopt;
+			}
+			T item = std::move(items_.front());
+			items_.pop_front();
+			not_full_.notify_one();
+			return item;
+		}
+
+		void close() {
+			std::lock_guard<std::mutex> lock(mutex_);
+			closed_ = true;
+			not_full_.notify_all();
+			not_empty_.notify_all();
+		}
+
+		void cancel() {
+			std::lock_guard<std::mutex> lock(mutex_);
+			closed_ = true;
+			items_.clear();
+			not_full_.notify_all();
+			not_empty_.notify_all();
+		}
+
+	private:
+		std::size_t capacity_;
+		std::deque<T> items_;
+		bool closed_ = false;
+		std::mutex mutex_;
+		std::condition_variable not_full_;
+		std::condition_variable not_empty_;
+	};
+
+}
@@ -0,0 +1,287 @@
+#pragma once
+#include "ExtendedCurve.h"
+#include "CurveRegistry.h"
+#include "Valuation.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+namespace ACHS {
+
+	// Read-mostly set of extended curves that can be updated while valuation threads are running.
+	// Readers pin an immutable snapshot of the registry without taking a lock and value against its
+	// frozen curves; writers are serialized, copy the registry, and publish the new snapshot with a single
+	// atomic store, so readers see either all of an update or none of it. Replaced snapshots are reclaimed
+	// once every reader that could have seen them has finished (epoch-based reclamation).
+	class ConcurrentCurves {
+		struct Snapshot;
+		struct Slot;
+
+	public:
+		// Pins the snapshot current at construction for its lifetime. Valuation mirrors ExtendedCurves'
+		// frozen mode; a Reader belongs to one thread.
+		class Reader {
+		public:
+			Reader(const Reader&) = delete;
+			Reader& operator=(const Reader&) = delete;
+
+			~Reader() {
+				slot_->epoch.store(0);
+				slot_->in_use.store(false);
+			}
+
+			const CurveRegistry& registry() const {
+				return snapshot_->registry;
+			}
+
+			// Version of the pinned snapshot; the initial, empty snapshot is version 1
+			std::uint64_t version() const {
+				return snapshot_->version;
+			}
+
+			void setActiveCurve(const std::string& name, const std::string& scenario = "") {
+				std::optional<CurveId> id = registry().find(name, scenario);
+				if (!id || !registry().contains(registry().index(*id))) {
+					throw std::runtime_error("ConcurrentCurves::Reader::setActiveCurve: curve '" + name + "' not found.");
+				}
+				setActiveCurve(registry().index(*id));
+			}
+
+			void setActiveCurve(const CurveId& id) {
+				setActiveCurve(registry().checkedIndex(id));
+			}
+
+			void setActiveCurve(Size index) {
+				if (!registry().contains(index)) {
+					throw std::runtime_error("ConcurrentCurves::Reader::setActiveCurve: curve index " + std::to_string(index) + " not found.");
+				}
+				active_ = &registry()[index];
+			}
+
+			std::shared_ptr<YieldTermStructure> activeCurve() const {
+				return entry().curve;
+			}
+
+			template<typename Instrument>
+			Real NPV(const Instrument& instrument) const {
+				return discountedValue(instrument, *entry().curve);
+			}
+
+			template<typename Instrument>
+			Real duration(const Instrument& instrument) const {
+				Real base = discountedValue(instrument, *entry().curve);
+				Real up = discountedValue(instrument, *entry().curve_up);
+				Real down = discountedValue(instrument, *entry().curve_down);
+				return effectiveDuration(base, up, down, snapshot_->spread);
+			}
+
+			template<typename Instrument>
+			Real convexity(const Instrument& instrument) const {
+				Real base = discountedValue(instrument, *entry().curve);
+				Real up = discountedValue(instrument, *entry().curve_up);
+				Real down = discountedValue(instrument, *entry().curve_down);
+				return effectiveConvexity(base, up, down, snapshot_->spread);
+			}
+
+		private:
+			friend class ConcurrentCurves;
+
+			Slot* slot_;
+			const Snapshot* snapshot_;
+			const CurveRegistry::Entry* active_ = nullptr;
+
+			Reader(Slot* slot, const Snapshot* snapshot) : slot_(slot), snapshot_(snapshot) {}
+
+			const CurveRegistry::Entry& entry() const {
+				if (!active_) {
+					throw std::runtime_error("ConcurrentCurves::Reader: no active curve.");
+				}
+				return *active_;
+			}
+		};
+
+		// reader_slots bounds the number of simultaneous Readers; further readers wait for a free slot.
+		// Publishing a curve takes over its base: the base is calculated, frozen if it is lazy and cut from
+		// the observer graph, so quote updates no longer reach it, here or for any other user. To follow the
+		// market, writers build new bases and publish curves on them.
+		ConcurrentCurves(Spread spread = 0.0001, Size reader_slots = 64) :
+			spread_(spread), slots_(reader_slots == 0 ? 1 : reader_slots) {
+
+			current_.store(new Snapshot{ CurveRegistry(spread), spread, 1 });
+		}
+
+		~ConcurrentCurves() {
+			delete current_.load();
+			for (const Retired& retired : retired_) {
+				delete retired.snapshot;
+			}
+		}
+
+		ConcurrentCurves(const ConcurrentCurves&) = delete;
+		ConcurrentCurves& operator=(const ConcurrentCurves&) = delete;
+
+		Reader read() const {
+			Slot* slot = acquireSlot();
+			// Announce the epoch before loading the snapshot, so that a writer retiring this snapshot
+			// afterwards sees the announcement
+			slot->epoch.store(epoch_.load());
+			return Reader(slot, current_.load());
+		}
+
+		template<typename Method>
+		void addOrUpdate(
+			const std::string& name,
+			const std::shared_ptr<YieldTermStructure>& base,
+			const Method& method,
+			const std::string& scenario = "")
+		{
+			update([&](CurveRegistry& registry) {
+				registry.addOrUpdate(registry.intern(name, scenario), std::make_shared<ExtendedCurveWrapper>(base, method));
+			});
+		}
+
+		void addOrUpdate(
+			const std::string& name,
+			const std::shared_ptr<ExtendedCurveWrapper>& wrapper,
+			const std::string& scenario = "")
+		{
+			update([&](CurveRegistry& registry) {
+				registry.addOrUpdate(registry.intern(name, scenario), wrapper);
+			});
+		}
+
+		// Publishes a whole set of curves as one snapshot
+		void addOrUpdate(
+			const std::vector<std::pair<std::string, std::shared_ptr<ExtendedCurveWrapper>>>& curves,
+			const std::string& scenario = "")
+		{
+			update([&](CurveRegistry& registry) {
+				for (const auto& [name, wrapper] : curves) {
+					registry.addOrUpdate(registry.intern(name, scenario), wrapper);
+				}
+			});
+		}
+
+		// Applies edit to a copy of the current registry and publishes the result. Writers are serialized,
+		// and QuantLib objects should only be built inside edit or before calling it. New curves are
+		// calculated, frozen and detached from the observer graph before readers can see them.
+		void update(const std::function<void(CurveRegistry&)>& edit) {
+			std::lock_guard<std::mutex> lock(writer_mutex_);
+
+			const Snapshot* previous = current_.load();
+			auto next = std::make_unique<Snapshot>(Snapshot{ previous->registry, spread_, previous->version + 1 });
+			edit(next->registry);
+
+			// Curves already published may be in use by readers and must not be touched again
+			std::unordered_set<const YieldTermStructure*> published;
+			for (Size i = 0; i < previous->registry.size(); ++i) {
+				if (previous->registry.contains(i)) {
+					published.insert(previous->registry[i].curve.get());
+				}
+			}
+			for (Size i = 0; i < next->registry.size(); ++i) {
+				if (next->registry.contains(i) && !published.count(next->registry[i].curve.get())) {
+					prepare(next->registry[i]);
+				}
+			}
+
+			current_.store(next.release());
+			retired_.push_back({ previous, epoch_.load() });
+			epoch_.fetch_add(1);
+			reclaim();
+		}
+
+		std::uint64_t version() const {
+			return current_.load()->version;
+		}
+
+	private:
+		struct Snapshot {
+			CurveRegistry registry;
+			Spread spread;
+			std::uint64_t version;
+		};
+
+		struct alignas(64) Slot {
+			std::atomic<bool> in_use{ false };
+			// Epoch announced by the reader holding the slot; zero when idle
+			std::atomic<std::uint64_t> epoch{ 0 };
+		};
+
+		struct Retired {
+			const Snapshot* snapshot;
+			std::uint64_t epoch;
+		};
+
+		Spread spread_;
+		mutable std::vector<Slot> slots_;
+		std::atomic<const Snapshot*> current_{ nullptr };
+		std::atomic<std::uint64_t> epoch_{ 1 };
+
+		std::mutex writer_mutex_;
+		std::vector<Retired> retired_;
+		std::unordered_set<const YieldTermStructure*> prepared_bases_;
+
+		Slot* acquireSlot() const {
+			Size start = std::hash<std::thread::id>()(std::this_thread::get_id()) % slots_.size();
+			for (;;) {
+				for (Size k = 0; k < slots_.size(); ++k) {
+					Slot& slot = slots_[(start + k) % slots_.size()];
+					bool expected = false;
+					if (!slot.in_use.load(std::memory_order_relaxed) && slot.in_use.compare_exchange_strong(expected, true)) {
+						return &slot;
+					}
+				}
+				std::this_thread::yield();
+			}
+		}
+
+		// A snapshot retired at epoch e can only be held by readers that announced an epoch of at most e
+		void reclaim() {
+			std::uint64_t oldest = epoch_.load();
+			for (const Slot& slot : slots_) {
+				std::uint64_t epoch = slot.epoch.load();
+				if (epoch != 0 && epoch < oldest) {
+					oldest = epoch;
+				}
+			}
+
+			auto live = std::remove_if(retired_.begin(), retired_.end(), [oldest](const Retired& retired) {
+				if (retired.epoch < oldest) {
+					delete retired.snapshot;
+					return true;
+				}
+				return false;
+			});
+			retired_.erase(live, retired_.end());
+		}
+
+		// Calculates a new curve and its base and cuts both from the observer graph, so that concurrent reads
+		// touch no mutable QuantLib state; a lazy base that stayed registered would still be marked for
+		// recalculation by quote updates while readers run
+		void prepare(const CurveRegistry::Entry& entry) {
+			std::shared_ptr<YieldTermStructure> base = entry.wrapper->base();
+			if (base && prepared_bases_.insert(base.get()).second) {
+				base->discount(0.0);
+				if (auto lazy = std::dynamic_pointer_cast<LazyObject>(base)) {
+					lazy->freeze();
+				}
+				base->unregisterWithAll();
+			}
+			entry.curve->discount(0.0);
+			entry.curve_up->discount(0.0);
+			entry.curve_down->discount(0.0);
+			entry.curve->unregisterWithAll();
+			entry.curve_up->unregisterWithAll();
+			entry.curve_down->unregisterWithAll();
+		}
+	};
+
+}
@@ -1,5 +1,6 @@
 #pragma once
 #include "ExtensionMethod.h"
+#include "HybridCurve.h"
 #include <ql/quantlib.hpp>
 #include <algorithm>
 #include <vector>
@@ -7,6 +8,7 @@ namespace ACHS {
 
 	using namespace QuantLib;
 
+	// Holds a continuously compounded ultimate rate from the start period to the end period.
 	template<typename Trait>
 	class Constant : public ExtensionMethod<Constant<Trait>, Trait> {
 		friend class ExtensionMethod<Constant<Trait>, Trait>;
@@ -16,49 +18,41 @@ namespace ACHS {
 			const Period& start_period,
 			const Period& end_period,
 			const Period& step = Period(1, Months)) :
-			ultimate_rate_(ultimate_rate),
-			ExtensionMethod<Constant<Trait>, Trait>(start_period, end_period, step) {}
+			ExtensionMethod<Constant<Trait>, Trait>(start_period, end_period, step),
+			ultimate_rate_(ultimate_rate) {}
 
 	protected:
 		std::shared_ptr<YieldTermStructure> buildCurveImpl(
 			const std::shared_ptr<YieldTermStructure>& base) const {
 
+			return std::make_shared<HybridCurve<Trait>>(
+				base,
+				base->referenceDate() + this->end_period_,
+				[method = *this](const std::shared_ptr<YieldTermStructure>& b) { return method.tail(b); });
+		}
+
+		typename HybridCurve<Trait>::Tail tail(
+			const std::shared_ptr<YieldTermStructure>& base) const {
+
 			DayCounter day_counter = base->dayCounter();
 
 			Date reference_date = base->referenceDate();
 
 			Date start_date = reference_date + this->start_period_;
-			Date end_date = reference_date + this->end_period_;
 
 			Time start_time = day_counter.yearFraction(reference_date, start_date);
-			Time end_time = day_counter.yearFraction(reference_date, end_date);
-
-			std::vector<Date> dates;
-			std::vector<Rate> rates;
-
-			for (Date d = reference_date; d <= end_date; d += this->step_) {
-				Time t = day_counter.yearFraction(reference_date, d);
-				Rate r;
-				if (t < start_time) {
-					r = extractRate<Trait>(base, t);
-				}
-				else {
-					r = ultimate_rate_;
-				}
-
-				dates.push_back(d);
-				rates.push_back(r);
-			}
-
-			if constexpr (std::is_same_v<Trait, Traits::Zero>) {
-				return std::make_shared<ZeroCurve>(dates, rates, day_counter);
-			}
-			else if constexpr (std::is_same_v<Trait, Traits::Forward>) {
-				return std::make_shared<ForwardCurve>(dates, rates, day_counter);
-			}
-			else {
-				throw std::runtime_error("Constant::buildCurveImpl: unknown trait.");
-			}
+
+			return { { start_time }, { annualFromContinuous(ultimate_rate_) } };
+		}
+
+		// The tail rate is fixed, so only the pre-start segment depends on the base
+		void adjointImpl(
+			const std::shared_ptr<YieldTermStructure>&,
+			const YieldTermStructure& curve,
+			const DiscountAdjoint& curve_adjoint,
+			DiscountAdjoint& base_adjoint) const {
+
+			dynamic_cast<const HybridCurve<Trait>&>(curve).adjoint(curve_adjoint, base_adjoint);
 		}
 	private:
 		Rate ultimate_rate_;
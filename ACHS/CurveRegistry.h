@@ -0,0 +1,218 @@
+#pragma once
+#include "ExtendedCurve.h"
+#include <ql/quantlib.hpp>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+namespace ACHS {
+
+	using namespace QuantLib;
+
+	// Interned coordinates of a curve in a CurveRegistry
+	struct CurveId {
+		Size base;
+		Size method;
+		Size scenario;
+	};
+
+	// Dense (scenario x base x method) store of extended curves. Base, method and scenario names are interned
+	// into integer ids once, curves are addressed by a flat index, and the zero-spread up and down curves are
+	// built when a curve is added so that valuation loops can iterate by index without allocating.
+	class CurveRegistry {
+	public:
+		struct Entry {
+			std::shared_ptr<ExtendedCurveWrapper> wrapper;
+			std::shared_ptr<YieldTermStructure> curve;
+			std::shared_ptr<YieldTermStructure> curve_up;
+			std::shared_ptr<YieldTermStructure> curve_down;
+
+			explicit operator bool() const {
+				return static_cast<bool>(wrapper);
+			}
+		};
+
+		CurveRegistry(Spread spread = 0.0001) {
+			spread_up_ = Handle<Quote>(std::make_shared<SimpleQuote>(spread));
+			spread_down_ = Handle<Quote>(std::make_shared<SimpleQuote>(-spread));
+			scenario_ids_[""] = 0;
+			scenario_names_.push_back("");
+		}
+
+		Size internBase(const std::string& name) {
+			return intern(name, base_ids_, base_names_);
+		}
+
+		Size internMethod(const std::string& name) {
+			return intern(name, method_ids_, method_names_);
+		}
+
+		Size internScenario(const std::string& name) {
+			return intern(name, scenario_ids_, scenario_names_);
+		}
+
+		// Interns a "BASE:METHOD" curve name; names without ':' are a base with an empty method
+		CurveId intern(const std::string& name, const std::string& scenario = "") {
+			auto [base, method] = split(name);
+			Size base_id = internBase(base);
+			Size method_id = internMethod(method);
+			return { base_id, method_id, internScenario(scenario) };
+		}
+
+		std::optional<CurveId> find(const std::string& name, const std::string& scenario = "") const {
+			auto [base, method] = split(name);
+			auto b = base_ids_.find(base);
+			auto m = method_ids_.find(method);
+			auto s = scenario_ids_.find(scenario);
+			if (b == base_ids_.end() || m == method_ids_.end() || s == scenario_ids_.end()) {
+				return std::nullopt;
+			}
+			return CurveId{ b->second, m->second, s->second };
+		}
+
+		void addOrUpdate(const CurveId& id, const std::shared_ptr<ExtendedCurveWrapper>& wrapper) {
+			Size i = checkedIndex(id);
+			if (i >= entries_.size()) {
+				entries_.resize(i + 1);
+			}
+
+			std::shared_ptr<YieldTermStructure> curve = wrapper->curve();
+			entries_[i].wrapper = wrapper;
+			entries_[i].curve = curve;
+			entries_[i].curve_up = std::make_shared<ZeroSpreadedTermStructure>(Handle<YieldTermStructure>(curve), spread_up_);
+			entries_[i].curve_down = std::make_shared<ZeroSpreadedTermStructure>(Handle<YieldTermStructure>(curve), spread_down_);
+		}
+
+		// Empties a curve's slot, releasing the registry's references to the curve and its spread curves
+		void remove(const CurveId& id) {
+			Size i = checkedIndex(id);
+			if (i < entries_.size()) {
+				entries_[i] = Entry();
+			}
+		}
+
+		Size index(const CurveId& id) const {
+			return (id.scenario * base_names_.size() + id.base) * method_names_.size() + id.method;
+		}
+
+		// True if every coordinate of id has been interned; other ids would alias another curve's slot
+		bool valid(const CurveId& id) const {
+			return id.base < base_names_.size() && id.method < method_names_.size() && id.scenario < scenario_names_.size();
+		}
+
+		Size checkedIndex(const CurveId& id) const {
+			if (!valid(id)) {
+				throw std::runtime_error("CurveRegistry::checkedIndex: curve id (" + std::to_string(id.base) + ", "
+					+ std::to_string(id.method) + ", " + std::to_string(id.scenario) + ") out of range for "
+					+ std::to_string(base_names_.size()) + " bases, " + std::to_string(method_names_.size())
+					+ " methods and " + std::to_string(scenario_names_.size()) + " scenarios.");
+			}
+			return index(id);
+		}
+
+		CurveId id(Size index) const {
+			Size methods = method_names_.size();
+			Size bases = base_names_.size();
+			return { (index / methods) % bases, index % methods, index / (methods * bases) };
+		}
+
+		// Number of slots; empty slots test false
+		Size size() const {
+			return entries_.size();
+		}
+
+		bool contains(Size index) const {
+			return index < entries_.size() && entries_[index];
+		}
+
+		const Entry& operator[](Size index) const {
+			return entries_[index];
+		}
+
+		const Entry& at(const CurveId& id) const {
+			Size i = checkedIndex(id);
+			if (!contains(i)) {
+				throw std::runtime_error("CurveRegistry::at: curve '" + name(id) + "' not found.");
+			}
+			return entries_[i];
+		}
+
+		std::string name(const CurveId& id) const {
+			const std::string& method = method_names_[id.method];
+			return method.empty() ? base_names_[id.base] : base_names_[id.base] + ":" + method;
+		}
+
+		const std::vector<std::string>& baseNames() const {
+			return base_names_;
+		}
+
+		const std::vector<std::string>& methodNames() const {
+			return method_names_;
+		}
+
+		const std::vector<std::string>& scenarioNames() const {
+			return scenario_names_;
+		}
+
+		const Handle<Quote>& spreadUp() const {
+			return spread_up_;
+		}
+
+		const Handle<Quote>& spreadDown() const {
+			return spread_down_;
+		}
+
+	private:
+		std::unordered_map<std::string, Size> base_ids_;
+		std::unordered_map<std::string, Size> method_ids_;
+		std::unordered_map<std::string, Size> scenario_ids_;
+		std::vector<std::string> base_names_;
+		std::vector<std::string> method_names_;
+		std::vector<std::string> scenario_names_;
+
+		std::vector<Entry> entries_;
+
+		Handle<Quote> spread_up_;
+		Handle<Quote> spread_down_;
+
+		static std::pair<std::string, std::string> split(const std::string& name) {
+			std::size_t colon = name.find(':');
+			if (colon == std::string::npos) {
+				return { name, "" };
+			}
+			return { name.substr(0, colon), name.substr(colon + 1) };
+		}
+
+		Size intern(
+			const std::string& name,
+			std::unordered_map<std::string, Size>& ids,
+			std::vector<std::string>& names)
+		{
+			auto it = ids.find(name);
+			if (it != ids.end()) {
+				return it->second;
+			}
+
+			Size bases = base_names_.size();
+			Size methods = method_names_.size();
+
+			Size id = names.size();
+			ids[name] = id;
+			names.push_back(name);
+
+			// A new scenario only appends; a new base or method changes the stride and moves existing curves
+			if (&names != &scenario_names_ && !entries_.empty()) {
+				std::vector<Entry> entries(scenario_names_.size() * base_names_.size() * method_names_.size());
+				for (Size i = 0; i < entries_.size(); ++i) {
+					if (entries_[i]) {
+						CurveId old{ (i / methods) % bases, i % methods, i / (methods * bases) };
+						entries[index(old)] = std::move(entries_[i]);
+					}
+				}
+				entries_ = std::move(entries);
+			}
+			return id;
+		}
+	};
+
+}
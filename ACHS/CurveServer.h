@@ -0,0 +1,435 @@
+#pragma once
+#if defined(_WIN32)
+#error "CurveServer.h requires POSIX shared memory."
+#endif
+#include "ExtendedCurves.h"
+#include <ql/quantlib.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ACHS {
+
+	using namespace QuantLib;
+
+	// Publishes curve sets into POSIX shared memory for local worker processes.
+	//
+	// A control segment "<name>" holds the current version. Each published version lives in its own
+	// segment "<name>.<version>" holding every curve's discount factors on a monthly node grid. A publish
+	// writes the new segment in full, swaps the version atomically and unlinks the previous segment; workers
+	// that still map it keep a valid view until they release it. Segments outlive the publisher process,
+	// so call CurvePublisher::unlink to remove them.
+	namespace SharedCurves {
+
+		constexpr std::uint64_t control_magic = 0x4143485343544C31; // "ACHSCTL1"
+		constexpr std::uint64_t segment_magic = 0x4143485343525631; // "ACHSCRV1"
+
+		static_assert(std::atomic<std::uint64_t>::is_always_lock_free,
+			"SharedCurves: shared-memory versioning needs a lock-free 64-bit atomic.");
+
+		struct ControlBlock {
+			std::uint64_t magic;
+			std::atomic<std::uint64_t> version;
+		};
+
+		struct SegmentHeader {
+			std::uint64_t magic;
+			std::uint64_t version;
+			std::int64_t reference_date;
+			std::uint64_t curve_count;
+			std::uint64_t node_count;
+			char day_counter[64];
+		};
+
+		struct CurveRecord {
+			char name[96];
+			std::uint64_t offset;
+			std::uint64_t nodes;
+			std::int64_t max_date;
+		};
+
+		inline std::string segmentName(const std::string& name, std::uint64_t version) {
+			return name + "." + std::to_string(version);
+		}
+
+		// Copies a name into a fixed, NUL-terminated field; truncating would let two long names collide
+		template<std::size_t N>
+		void copyName(char (&field)[N], const std::string& name, const char* what) {
+			if (name.size() >= N) {
+				throw std::runtime_error("SharedCurves: " + std::string(what) + " '" + name + "' is longer than "
+					+ std::to_string(N - 1) + " characters.");
+			}
+			std::memset(field, 0, N);
+			std::memcpy(field, name.data(), name.size());
+		}
+
+		// Read-only or read-write mapping of a shared-memory object, unmapped on destruction
+		class Mapping {
+		public:
+			Mapping(const std::string& name, int flags, std::size_t size = 0) {
+				int fd = shm_open(name.c_str(), flags, 0644);
+				if (fd < 0) {
+					errno_ = errno;
+					return;
+				}
+				if (flags & O_CREAT) {
+					if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+						errno_ = errno;
+						close(fd);
+						return;
+					}
+				}
+				else {
+					struct stat st;
+					if (fstat(fd, &st) != 0) {
+						errno_ = errno;
+						close(fd);
+						return;
+					}
+					size = static_cast<std::size_t>(st.st_size);
+				}
+
+				int protection = ((flags & O_ACCMODE) == O_RDONLY) ? PROT_READ : PROT_READ | PROT_WRITE;
+				void* address = mmap(nullptr, size, protection, MAP_SHARED, fd, 0);
+				close(fd);
+				if (address == MAP_FAILED) {
+					errno_ = errno;
+					return;
+				}
+				address_ = address;
+				size_ = size;
+			}
+
+			~Mapping() {
+				if (address_) {
+					munmap(address_, size_);
+				}
+			}
+
+			Mapping(const Mapping&) = delete;
+			Mapping& operator=(const Mapping&) = delete;
+
+			explicit operator bool() const { return address_ != nullptr; }
+			void* address() const { return address_; }
+			std::size_t size() const { return size_; }
+			int error() const { return errno_; }
+
+		private:
+			void* address_ = nullptr;
+			std::size_t size_ = 0;
+			int errno_ = 0;
+		};
+
+	}
+
+	// Zero-copy YieldTermStructure over a node grid held elsewhere, typically in a shared-memory mapping.
+	// Discount factors are interpolated log-linearly and extrapolated at the last segment's forward rate.
+	class SharedCurveView : public YieldTermStructure {
+	public:
+		SharedCurveView(
+			const Date& reference_date,
+			const DayCounter& day_counter,
+			const Date& max_date,
+			const double* times,
+			const double* discounts,
+			std::size_t nodes,
+			std::shared_ptr<const void> holder) :
+			YieldTermStructure(reference_date, Calendar(), day_counter),
+			max_date_(max_date), times_(times), discounts_(discounts), nodes_(nodes), holder_(std::move(holder)) {}
+
+		Date maxDate() const override {
+			return max_date_;
+		}
+
+	protected:
+		DiscountFactor discountImpl(Time t) const override {
+			if (t <= times_[0] || nodes_ < 2) {
+				return discounts_[0];
+			}
+			std::size_t k = std::upper_bound(times_, times_ + nodes_, t) - times_;
+			k = std::min(k, nodes_ - 1);
+			Real w = (t - times_[k - 1]) / (times_[k] - times_[k - 1]);
+			return discounts_[k - 1] * std::pow(discounts_[k] / discounts_[k - 1], w);
+		}
+
+	private:
+		Date max_date_;
+		const double* times_;
+		const double* discounts_;
+		std::size_t nodes_;
+		std::shared_ptr<const void> holder_;
+	};
+
+	// One published version of the curve set as seen by a worker. Views keep the mapping alive.
+	class SharedCurveSet : public std::enable_shared_from_this<SharedCurveSet> {
+	public:
+		SharedCurveSet(std::unique_ptr<SharedCurves::Mapping> mapping, const DayCounter& day_counter) :
+			mapping_(std::move(mapping)), day_counter_(day_counter) {
+
+			const auto* base = static_cast<const char*>(mapping_->address());
+			header_ = reinterpret_cast<const SharedCurves::SegmentHeader*>(base);
+			if (mapping_->size() < sizeof(SharedCurves::SegmentHeader) || header_->magic != SharedCurves::segment_magic) {
+				throw std::runtime_error("SharedCurveSet: segment is not a published curve set.");
+			}
+			if (!terminated(header_->day_counter)) {
+				throw std::runtime_error("SharedCurveSet: segment header is corrupt.");
+			}
+			if (day_counter_.name() != std::string(header_->day_counter)) {
+				throw std::runtime_error("SharedCurveSet: published with day counter '" + std::string(header_->day_counter) + "'.");
+			}
+
+			// The counts come from shared memory; the records and both node arrays must fit in the mapping
+			std::size_t available = mapping_->size() - sizeof(SharedCurves::SegmentHeader);
+			if (header_->curve_count > available / sizeof(SharedCurves::CurveRecord)) {
+				throw std::runtime_error("SharedCurveSet: segment too small for " + std::to_string(header_->curve_count) + " curves.");
+			}
+			available -= static_cast<std::size_t>(header_->curve_count) * sizeof(SharedCurves::CurveRecord);
+			if (header_->node_count > available / (2 * sizeof(double))) {
+				throw std::runtime_error("SharedCurveSet: segment too small for " + std::to_string(header_->node_count) + " nodes.");
+			}
+
+			records_ = reinterpret_cast<const SharedCurves::CurveRecord*>(base + sizeof(SharedCurves::SegmentHeader));
+			times_ = reinterpret_cast<const double*>(records_ + header_->curve_count);
+			discounts_ = times_ + header_->node_count;
+
+			for (Size i = 0; i < size(); ++i) {
+				const SharedCurves::CurveRecord& record = records_[i];
+				if (!terminated(record.name) || record.nodes == 0 || record.offset > header_->node_count
+					|| record.nodes > header_->node_count - record.offset) {
+					throw std::runtime_error("SharedCurveSet: curve record " + std::to_string(i) + " lies outside the segment.");
+				}
+			}
+		}
+
+		std::uint64_t version() const {
+			return header_->version;
+		}
+
+		Date referenceDate() const {
+			return Date(static_cast<Date::serial_type>(header_->reference_date));
+		}
+
+		Size size() const {
+			return static_cast<Size>(header_->curve_count);
+		}
+
+		std::string name(Size i) const {
+			return std::string(records_[i].name);
+		}
+
+		std::shared_ptr<YieldTermStructure> curve(Size i) const {
+			const SharedCurves::CurveRecord& record = records_[i];
+			return std::make_shared<SharedCurveView>(
+				referenceDate(),
+				day_counter_,
+				Date(static_cast<Date::serial_type>(record.max_date)),
+				times_ + record.offset,
+				discounts_ + record.offset,
+				static_cast<std::size_t>(record.nodes),
+				shared_from_this());
+		}
+
+		// Registers every published curve in an ExtendedCurves under its published name
+		void loadInto(ExtendedCurves& curves) const {
+			for (Size i = 0; i < size(); ++i) {
+				curves.addOrUpdate(name(i), std::make_shared<ExtendedCurveWrapper>(curve(i)));
+			}
+		}
+
+	private:
+		std::unique_ptr<SharedCurves::Mapping> mapping_;
+		DayCounter day_counter_;
+		const SharedCurves::SegmentHeader* header_;
+		const SharedCurves::CurveRecord* records_;
+		const double* times_;
+		const double* discounts_;
+
+		// Fixed-size names from shared memory are only read as strings if they end within their field
+		template<std::size_t N>
+		static bool terminated(const char (&field)[N]) {
+			return std::memchr(field, '\0', N) != nullptr;
+		}
+	};
+
+	class CurvePublisher {
+	public:
+		CurvePublisher(const std::string& name, const DayCounter& day_counter, const Period& step = Period(1, Months)) :
+			name_(name), day_counter_(day_counter), step_(step) {
+
+			control_ = std::make_unique<SharedCurves::Mapping>(name_, O_CREAT | O_RDWR, sizeof(SharedCurves::ControlBlock));
+			if (!*control_) {
+				throw std::runtime_error("CurvePublisher: failed to create control segment '" + name_ + "': " + std::strerror(control_->error()) + ".");
+			}
+
+			auto* control = static_cast<SharedCurves::ControlBlock*>(control_->address());
+			if (control->magic != SharedCurves::control_magic) {
+				new (&control->version) std::atomic<std::uint64_t>(0);
+				control->magic = SharedCurves::control_magic;
+			}
+		}
+
+		// Samples each curve onto the node grid and atomically replaces the published set
+		std::uint64_t publish(const std::vector<std::pair<std::string, std::shared_ptr<YieldTermStructure>>>& curves) {
+			if (curves.empty()) {
+				throw std::runtime_error("CurvePublisher::publish: no curves to publish.");
+			}
+
+			Date reference_date = curves.front().second->referenceDate();
+
+			std::vector<SharedCurves::CurveRecord> records(curves.size());
+			std::vector<double> times;
+			std::vector<double> discounts;
+
+			for (std::size_t i = 0; i < curves.size(); ++i) {
+				const auto& [name, curve] = curves[i];
+				if (curve->referenceDate() != reference_date) {
+					throw std::runtime_error("CurvePublisher::publish: curve '" + name + "' has a different reference date.");
+				}
+
+				SharedCurves::CurveRecord& record = records[i];
+				std::memset(&record, 0, sizeof(record));
+				SharedCurves::copyName(record.name, name, "curve name");
+				record.offset = times.size();
+				record.max_date = curve->maxDate().serialNumber();
+
+				for (Integer k = 0; ; ++k) {
+					Date d = reference_date + k * step_;
+					if (d > curve->maxDate()) {
+						break;
+					}
+					times.push_back(day_counter_.yearFraction(reference_date, d));
+					discounts.push_back(curve->discount(d));
+				}
+				record.nodes = times.size() - record.offset;
+			}
+
+			auto* control = static_cast<SharedCurves::ControlBlock*>(control_->address());
+			std::uint64_t previous = control->version.load(std::memory_order_acquire);
+			std::uint64_t version = previous + 1;
+
+			std::size_t size = sizeof(SharedCurves::SegmentHeader)
+				+ records.size() * sizeof(SharedCurves::CurveRecord)
+				+ 2 * times.size() * sizeof(double);
+
+			SharedCurves::SegmentHeader header{};
+			header.magic = SharedCurves::segment_magic;
+			header.version = version;
+			header.reference_date = reference_date.serialNumber();
+			header.curve_count = records.size();
+			header.node_count = times.size();
+			SharedCurves::copyName(header.day_counter, day_counter_.name(), "day counter name");
+
+			std::string segment = SharedCurves::segmentName(name_, version);
+			{
+				SharedCurves::Mapping mapping(segment, O_CREAT | O_EXCL | O_RDWR, size);
+				if (!mapping) {
+					throw std::runtime_error("CurvePublisher::publish: failed to create segment '" + segment + "': " + std::strerror(mapping.error()) + ".");
+				}
+
+				char* base = static_cast<char*>(mapping.address());
+				std::memcpy(base, &header, sizeof(header));
+				base += sizeof(header);
+				std::memcpy(base, records.data(), records.size() * sizeof(SharedCurves::CurveRecord));
+				base += records.size() * sizeof(SharedCurves::CurveRecord);
+				std::memcpy(base, times.data(), times.size() * sizeof(double));
+				base += times.size() * sizeof(double);
+				std::memcpy(base, discounts.data(), discounts.size() * sizeof(double));
+			}
+
+			control->version.store(version, std::memory_order_release);
+			if (previous > 0) {
+				shm_unlink(SharedCurves::segmentName(name_, previous).c_str());
+			}
+			return version;
+		}
+
+		// Publishes the registry's curves for one scenario under their registry names
+		std::uint64_t publish(const CurveRegistry& registry, const std::string& scenario = "") {
+			std::vector<std::pair<std::string, std::shared_ptr<YieldTermStructure>>> curves;
+			for (Size i = 0; i < registry.size(); ++i) {
+				CurveId id = registry.id(i);
+				if (registry.contains(i) && registry.scenarioNames()[id.scenario] == scenario) {
+					curves.emplace_back(registry.name(id), registry[i].curve);
+				}
+			}
+			return publish(curves);
+		}
+
+		std::uint64_t publish(const ExtendedCurves& curves, const std::string& scenario = "") {
+			return publish(curves.registry(), scenario);
+		}
+
+		// Removes the control segment and the current version; attached workers keep their mappings
+		static void unlink(const std::string& name) {
+			SharedCurves::Mapping control(name, O_RDONLY);
+			if (control) {
+				auto* block = static_cast<const SharedCurves::ControlBlock*>(control.address());
+				std::uint64_t version = block->version.load(std::memory_order_acquire);
+				if (version > 0) {
+					shm_unlink(SharedCurves::segmentName(name, version).c_str());
+				}
+			}
+			shm_unlink(name.c_str());
+		}
+
+	private:
+		std::string name_;
+		DayCounter day_counter_;
+		Period step_;
+		std::unique_ptr<SharedCurves::Mapping> control_;
+	};
+
+	class CurveSubscriber {
+	public:
+		CurveSubscriber(const std::string& name, const DayCounter& day_counter) :
+			name_(name), day_counter_(day_counter) {
+
+			control_ = std::make_unique<SharedCurves::Mapping>(name_, O_RDONLY);
+			if (!*control_) {
+				throw std::runtime_error("CurveSubscriber: failed to open control segment '" + name_ + "': " + std::strerror(control_->error()) + ".");
+			}
+			if (static_cast<const SharedCurves::ControlBlock*>(control_->address())->magic != SharedCurves::control_magic) {
+				throw std::runtime_error("CurveSubscriber: '" + name_ + "' is not a curve server.");
+			}
+		}
+
+		std::uint64_t version() const {
+			return static_cast<const SharedCurves::ControlBlock*>(control_->address())->version.load(std::memory_order_acquire);
+		}
+
+		// Maps the current version read-only. Retries if the publisher swaps versions while attaching.
+		std::shared_ptr<const SharedCurveSet> attach() const {
+			for (;;) {
+				std::uint64_t current = version();
+				if (current == 0) {
+					throw std::runtime_error("CurveSubscriber::attach: nothing published to '" + name_ + "' yet.");
+				}
+
+				auto mapping = std::make_unique<SharedCurves::Mapping>(SharedCurves::segmentName(name_, current), O_RDONLY);
+				if (*mapping) {
+					return std::make_shared<SharedCurveSet>(std::move(mapping), day_counter_);
+				}
+				if (mapping->error() != ENOENT || version() == current) {
+					throw std::runtime_error("CurveSubscriber::attach: failed to map version " + std::to_string(current) + ": " + std::strerror(mapping->error()) + ".");
+				}
+			}
+		}
+
+	private:
+		std::string name_;
+		DayCounter day_counter_;
+		std::unique_ptr<SharedCurves::Mapping> control_;
+	};
+
+}
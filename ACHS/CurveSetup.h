@@ -0,0 +1,113 @@
+#pragma once
+#include "TreasuryQuote.h"
+#include "ExtendedCurve.h"
+#include "Constant.h"
+#include "Flat.h"
+#include "LinearlyGraded.h"
+#include "RollingAverage.h"
+#include "DualBlended.h"
+#include "SmithWilson.h"
+#include <ql/quantlib.hpp>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+namespace ACHS {
+
+	using namespace QuantLib;
+
+	// The market, base curves and extension methods of the study, shared by the program and the benchmarks
+
+	// Treasury par quotes as of 31 Dec 2024
+	inline std::vector<TreasuryQuote> treasuryQuotes() {
+		return {
+			TreasuryQuote(100.0000, 4.2275, Period(1, Months)),
+			TreasuryQuote(100.0000, 4.2225, Period(2, Months)),
+			TreasuryQuote(100.0000, 4.2150, Period(3, Months)),
+			TreasuryQuote(100.0000, 4.2150, Period(4, Months)),
+			TreasuryQuote(100.0000, 4.0575, Period(6, Months)),
+			TreasuryQuote(100.0000, 3.8575, Period(1, Years)),
+			TreasuryQuote(100.0898, 3.8750, Period(2, Years)),
+			TreasuryQuote(099.7695, 3.7500, Period(3, Years)),
+			TreasuryQuote(100.1953, 4.0000, Period(5, Years)),
+			TreasuryQuote(100.0078, 4.1250, Period(7, Years)),
+			TreasuryQuote(102.4688, 4.6250, Period(10, Years)),
+			TreasuryQuote(100.0000, (4.6250 + 4.7500) / 2.0, Period(15, Years)),    //synthetic
+			TreasuryQuote(099.3281, 4.7500, Period(20, Years)),
+			TreasuryQuote(100.0000, (4.75 + 4.625) / 2.0, Period(25, Years)),       //synthetic
+			TreasuryQuote(097.7500, 4.6250, Period(30, Years)) };                   // base quote is 4.625% par
+	}
+
+	using BaseFactory = std::function<std::shared_ptr<YieldTermStructure>()>;
+
+	// Named base curves on the quotes. Every call of a factory makes its own helpers, so bases can bootstrap
+	// concurrently; the helpers share the quotes' market quotes, so setting a quote moves every base.
+	inline std::vector<std::pair<std::string, BaseFactory>> baseFactories(const std::vector<TreasuryQuote>& quotes, const Date& today) {
+		auto rate_helpers = [quotes]() {
+			std::vector<std::shared_ptr<RateHelper>> helpers;
+			for (const TreasuryQuote& quote : quotes) {
+				helpers.push_back(quote.makeHelper<RateHelper>());
+			}
+			return helpers;
+		};
+		auto bond_helpers = [quotes]() {
+			std::vector<std::shared_ptr<BondHelper>> helpers;
+			for (const TreasuryQuote& quote : quotes) {
+				helpers.push_back(quote.makeHelper<BondHelper>());
+			}
+			return helpers;
+		};
+
+		DayCounter dc = ActualActual(ActualActual::Actual365);
+		Calendar calendar = UnitedStates(UnitedStates::GovernmentBond);
+
+		return {
+			{"PIECEWISE_ZERO_LINEAR", [=]() { return std::make_shared<PiecewiseYieldCurve<ZeroYield, Linear>>(today, rate_helpers(), dc); }},
+			{"PIECEWISE_DISCOUNT_LOGLINEAR", [=]() { return std::make_shared<PiecewiseYieldCurve<Discount, LogLinear>>(today, rate_helpers(), dc); }},
+			{"PIECEWISE_ZERO_CUBIC", [=]() { return std::make_shared<PiecewiseYieldCurve<ZeroYield, Cubic>>(today, rate_helpers(), dc); }},
+			{"FITTED_NELSON_SIEGEL", [=]() { return std::make_shared<FittedBondDiscountCurve>(0, calendar, bond_helpers(), dc, NelsonSiegelFitting()); }},
+			{"FITTED_NELSON_SIEGEL_SVENSSON", [=]() { return std::make_shared<FittedBondDiscountCurve>(0, calendar, bond_helpers(), dc, SvenssonFitting()); }},
+			{"FITTED_EXPONENTIAL_SPLINES", [=]() { return std::make_shared<FittedBondDiscountCurve>(0, calendar, bond_helpers(), dc, ExponentialSplinesFitting()); }}
+		};
+	}
+
+	using Extension = std::function<std::shared_ptr<ExtendedCurveWrapper>(const std::shared_ptr<YieldTermStructure>&)>;
+
+	template<typename Method>
+	Extension extension(const Method& method) {
+		return [method](const std::shared_ptr<YieldTermStructure>& base) {
+			return std::make_shared<ExtendedCurveWrapper>(base, method);
+		};
+	}
+
+	// Named extension methods, each extending from 30 to 100 years
+	inline std::vector<std::pair<std::string, Extension>> extensionMethods() {
+		return {
+			// Forward-rate extensions
+			{"FLAT_FORWARD", extension(Flat<Traits::Forward>(Period(30, Years), Period(100, Years)))},
+			{"CONSTANT_FORWARD", extension(Constant<Traits::Forward>(Rate(0.05), Period(30, Years), Period(100, Years)))},
+			{"LINEARLY_GRADED_FORWARD", extension(LinearlyGraded<Traits::Forward>(Rate(0.05), Period(30, Years), Period(40, Years), Period(100, Years)))},
+			{"ROLLING_AVERAGE_FORWARD", extension(RollingAverage<Traits::Forward>(60, Period(30, Years), Period(100, Years)))},
+			{"DUAL_BLENDED_FORWARD", extension(DualBlended<Traits::Forward>(Period(30, Years), Period(100, Years)))},
+			// Zero-rate extensions
+			{"FLAT_ZERO", extension(Flat<Traits::Zero>(Period(30, Years), Period(100, Years)))},
+			{"CONSTANT_ZERO", extension(Constant<Traits::Zero>(Rate(0.05), Period(30, Years), Period(100, Years)))},
+			{"LINEARLY_GRADED_ZERO", extension(LinearlyGraded<Traits::Zero>(Rate(0.05), Period(30, Years), Period(40, Years), Period(100, Years)))},
+			{"ROLLING_AVERAGE_ZERO", extension(RollingAverage<Traits::Zero>(60, Period(30, Years), Period(100, Years)))},
+			{"DUAL_BLENDED_ZERO", extension(DualBlended<Traits::Zero>(Period(30, Years), Period(100, Years)))},
+			// Smith-Wilson extrapolation to an ultimate forward rate
+			{"SMITH_WILSON", extension(SmithWilson(Rate(0.05), 0.1, Period(30, Years), Period(100, Years)))}
+		};
+	}
+
+	// Semiannual fixed-rate bond issued today
+	inline std::shared_ptr<Bond> makeBond(const Date& today, const Period& tenor, Rate coupon = 0.05) {
+		Calendar calendar = UnitedStates(UnitedStates::GovernmentBond);
+		Date maturity = calendar.advance(today, tenor);
+		Schedule schedule(today, maturity, Period(Semiannual), calendar,
+			Unadjusted, Unadjusted, DateGeneration::Backward, false);
+		return std::make_shared<FixedRateBond>(
+			1, 100.0, schedule, std::vector<Rate>{coupon}, ActualActual(ActualActual::Bond));
+	}
+
+}
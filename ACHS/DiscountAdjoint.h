@@ -0,0 +1,37 @@
+#pragma once
+#include <ql/quantlib.hpp>
+#include <map>
+namespace ACHS {
+
+	using namespace QuantLib;
+
+	// Adjoint of an output with respect to a curve's discount factors, d(output) / dD(t), accumulated over
+	// the times t at which the output reads the curve. Reverse sweeps through valuation and extension read
+	// one of these and accumulate into another.
+	class DiscountAdjoint {
+	public:
+		void add(Time t, Real adjoint) {
+			adjoints_[t] += adjoint;
+		}
+
+		bool empty() const {
+			return adjoints_.empty();
+		}
+
+		Size size() const {
+			return adjoints_.size();
+		}
+
+		std::map<Time, Real>::const_iterator begin() const {
+			return adjoints_.begin();
+		}
+
+		std::map<Time, Real>::const_iterator end() const {
+			return adjoints_.end();
+		}
+
+	private:
+		std::map<Time, Real> adjoints_;
+	};
+
+}
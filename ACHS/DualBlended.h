@@ -1,5 +1,6 @@
 #pragma once
 #include "ExtensionMethod.h"
+#include "HybridCurve.h"
 #include <ql/quantlib.hpp>
 #include <algorithm>
 #include <vector>
@@ -8,6 +9,8 @@ namespace ACHS {
 
 	using namespace QuantLib;
 
+	// Holds the average of the base's annually compounded rates at d1 and d2 from the start period to the
+	// end period. Earlier versions read that average as continuously compounded.
 	template<typename Trait>
 	class DualBlended : public ExtensionMethod<DualBlended<Trait>, Trait> {
 		friend class ExtensionMethod<DualBlended<Trait>, Trait>;
@@ -18,22 +21,29 @@ namespace ACHS {
 			const Period& step = Period(1, Months),
 			const Period& d1 = Period(20, Years),
 			const Period& d2 = Period(30, Years)) :
-			d1_(d1), d2_(d2),
-			ExtensionMethod<DualBlended<Trait>, Trait>(start_period, end_period, step) {}
+			ExtensionMethod<DualBlended<Trait>, Trait>(start_period, end_period, step),
+			d1_(d1), d2_(d2) {}
 
 	protected:
 		std::shared_ptr<YieldTermStructure> buildCurveImpl(
 			const std::shared_ptr<YieldTermStructure>& base) const {
 
+			return std::make_shared<HybridCurve<Trait>>(
+				base,
+				base->referenceDate() + this->end_period_,
+				[method = *this](const std::shared_ptr<YieldTermStructure>& b) { return method.tail(b); });
+		}
+
+		typename HybridCurve<Trait>::Tail tail(
+			const std::shared_ptr<YieldTermStructure>& base) const {
+
 			DayCounter day_counter = base->dayCounter();
 
 			Date reference_date = base->referenceDate();
 
 			Date start_date = reference_date + this->start_period_;
-			Date end_date = reference_date + this->end_period_;
 
 			Time start_time = day_counter.yearFraction(reference_date, start_date);
-			Time end_time = day_counter.yearFraction(reference_date, end_date);
 
 			Time t1 = day_counter.yearFraction(reference_date, reference_date + d1_);
 			Time t2 = day_counter.yearFraction(reference_date, reference_date + d2_);
@@ -41,32 +51,24 @@ namespace ACHS {
 			Rate r2 = extractRate<Trait>(base, t2);
 			Rate ultimate = (r1 + r2) / 2.0;
 
-			std::vector<Date> dates;
-			std::vector<Rate> rates;
-
-			for (Date d = reference_date; d <= end_date; d += this->step_) {
-				Time t = day_counter.yearFraction(reference_date, d);
-				Rate r = (t < start_time) ? extractRate<Trait>(base, t) : ultimate;
-
-				dates.push_back(d);
-				rates.push_back(r);
-			}
-
-			for (std::size_t i = 1; i < dates.size(); ++i) {
-				if (dates[i] == dates[i - 1]) {
-					std::cerr << "Duplicate date: " << dates[i] << std::endl;
-				}
-			}
-
-			if constexpr (std::is_same_v<Trait, Traits::Zero>) {
-				return std::make_shared<ZeroCurve>(dates, rates, day_counter);
-			}
-			else if constexpr (std::is_same_v<Trait, Traits::Forward>) {
-				return std::make_shared<ForwardCurve>(dates, rates, day_counter);
-			}
-			else {
-				throw std::runtime_error("DualBlended::buildCurveImpl: unknown trait.");
-			}
+			return { { start_time }, { ultimate } };
+		}
+
+		void adjointImpl(
+			const std::shared_ptr<YieldTermStructure>& base,
+			const YieldTermStructure& curve,
+			const DiscountAdjoint& curve_adjoint,
+			DiscountAdjoint& base_adjoint) const {
+
+			DayCounter day_counter = base->dayCounter();
+			Date reference_date = base->referenceDate();
+
+			Time t1 = day_counter.yearFraction(reference_date, reference_date + d1_);
+			Time t2 = day_counter.yearFraction(reference_date, reference_date + d2_);
+
+			std::vector<Real> rate_adjoints = dynamic_cast<const HybridCurve<Trait>&>(curve).adjoint(curve_adjoint, base_adjoint);
+			extractRateAdjoint<Trait>(base, t1, rate_adjoints.front() / 2.0, base_adjoint);
+			extractRateAdjoint<Trait>(base, t2, rate_adjoints.front() / 2.0, base_adjoint);
 		}
 	private:
 		Period d1_;
@@ -1,4 +1,5 @@
 #pragma once
+#include "DiscountAdjoint.h"
 #include <ql/quantlib.hpp>
 namespace ACHS {
 	using namespace QuantLib;
@@ -9,7 +10,10 @@ namespace ACHS {
 			const std::shared_ptr<YieldTermStructure>& base,
 			const Method& method) { 
 		
-			base->enableExtrapolation();
+			// Only write the flag when needed; the base may be shared with curves being read concurrently
+			if (!base->allowsExtrapolation()) {
+				base->enableExtrapolation();
+			}
 			extended_curve_ = method.buildCurve(base);
 		}
 
@@ -25,18 +29,43 @@ namespace ACHS {
 		template<typename Method>
 		ExtendedCurveWrapper(
 			const std::shared_ptr<YieldTermStructure>& base,
-			const Method& method) {
+			const Method& method) : base_(base) {
 
 			auto curve = std::make_shared<ExtendedCurve<Method>>(base, method);
 			extended_curve_ = [curve]() { return curve->curve(); };
 
 			holder_ = curve; // Force curve to remain alive
+
+			adjoint_ = [curve, base, method](const DiscountAdjoint& curve_adjoint, DiscountAdjoint& base_adjoint) {
+				method.adjoint(base, *curve->curve(), curve_adjoint, base_adjoint);
+			};
  			}
+		// Wraps a curve that has already been extended elsewhere
+		explicit ExtendedCurveWrapper(const std::shared_ptr<YieldTermStructure>& curve) {
+			extended_curve_ = [curve]() { return curve; };
+		}
+
 		std::shared_ptr<YieldTermStructure> curve() const { return extended_curve_(); }
 
+		// Curve the extension was built from; empty for prebuilt curves
+		std::shared_ptr<YieldTermStructure> base() const { return base_; }
+
+		// Reverse sweep through the extension, from the adjoint of an output with respect to curve()'s
+		// discount factors to its adjoint with respect to base()'s
+		void adjoint(const DiscountAdjoint& curve_adjoint, DiscountAdjoint& base_adjoint) const {
+			if (!adjoint_) {
+				throw std::runtime_error("ExtendedCurveWrapper::adjoint: curve was not built by an extension method.");
+			}
+			adjoint_(curve_adjoint, base_adjoint);
+		}
+
 	private:
 		std::function<std::shared_ptr<YieldTermStructure>()> extended_curve_;
 
+		std::function<void(const DiscountAdjoint&, DiscountAdjoint&)> adjoint_;
+
 		std::shared_ptr<void> holder_;
+
+		std::shared_ptr<YieldTermStructure> base_;
 	};
 }
\ No newline at end of file
@@ -1,11 +1,13 @@
 #pragma once
 #include "ExtendedCurve.h"
+#include "CurveRegistry.h"
+#include "Valuation.h"
 namespace ACHS {
 	class ExtendedCurves {
 	public:
-		ExtendedCurves(Spread spread = 0.0001) {
-			spread_up_ = Handle<Quote>(std::make_shared<SimpleQuote>(spread));
-			spread_down_ = Handle<Quote>(std::make_shared<SimpleQuote>(-spread));
+		ExtendedCurves(Spread spread = 0.0001) : registry_(spread) {
+			spread_up_ = registry_.spreadUp();
+			spread_down_ = registry_.spreadDown();
 			bond_engine_ = std::make_shared<DiscountingBondEngine>(active_curve_);
 		}
 
@@ -13,60 +15,136 @@ namespace ACHS {
 		void addOrUpdate(
 			const std::string& name,
 			const std::shared_ptr<YieldTermStructure>& base,
-			const Method& method) 
+			const Method& method,
+			const std::string& scenario = "") 
 		{
-			curve_map_[name] = std::make_shared<ExtendedCurveWrapper>(
-				base,
-				method);
+			add(registry_.intern(name, scenario), std::make_shared<ExtendedCurveWrapper>(base, method));
 		}
 
 		void addOrUpdate(
 			const std::string& name,
-			const std::shared_ptr<ExtendedCurveWrapper>& wrapper) 
+			const std::shared_ptr<ExtendedCurveWrapper>& wrapper,
+			const std::string& scenario = "") 
 		{
-			curve_map_[name] = wrapper;
+			add(registry_.intern(name, scenario), wrapper);
 		}
 
-		void setActiveCurve(const std::string& name) 
+		template<typename Method>
+		void addOrUpdate(
+			const CurveId& id,
+			const std::shared_ptr<YieldTermStructure>& base,
+			const Method& method)
+		{
+			add(id, std::make_shared<ExtendedCurveWrapper>(base, method));
+		}
+
+		// Drops a curve and its spread curves; removing the active curve leaves no curve active
+		void remove(const std::string& name, const std::string& scenario = "")
 		{
-			auto it = curve_map_.find(name);
-			if (it == curve_map_.end()) {
+			std::optional<CurveId> id = registry_.find(name, scenario);
+			if (!id || !registry_.contains(registry_.index(*id))) {
 				throw std::runtime_error("Curve '" + name + "' not found");
 			}
+			bool active = active_curve_ptr_ && registry_.index(*id) == registry_.index(active_id_);
+			registry_.remove(*id);
+			if (active) {
+				active_curve_ptr_.reset();
+				active_curve_up_.reset();
+				active_curve_down_.reset();
+				if (!frozen_) {
+					active_curve_.linkTo(std::shared_ptr<YieldTermStructure>());
+				}
+			}
+		}
+
+		void setActiveCurve(const std::string& name) 
+		{
+			setActiveCurve(name, "");
+		}
+
+		// Activates a curve of a scenario, such as one added by ScenarioChunk::addTo
+		void setActiveCurve(const std::string& name, const std::string& scenario)
+		{
+			std::optional<CurveId> id = registry_.find(name, scenario);
+			if (!id || !registry_.contains(registry_.index(*id))) {
+				throw std::runtime_error("Curve '" + name + "' not found" + (scenario.empty() ? "" : " in scenario '" + scenario + "'"));
+			}
+			setActiveCurve(registry_.index(*id));
+		}
 
-			active_curve_name_ = name;
-			active_curve_.linkTo(it->second->curve());
-			active_curve_up_ = std::make_shared<ZeroSpreadedTermStructure>(Handle<YieldTermStructure>(it->second->curve()), spread_up_);
-			active_curve_down_ = std::make_shared<ZeroSpreadedTermStructure>(Handle<YieldTermStructure>(it->second->curve()), spread_down_);
+		void setActiveCurve(const CurveId& id)
+		{
+			setActiveCurve(registry_.checkedIndex(id));
+		}
 
+		// Activates the curve at a registry index, reusing its prebuilt spread curves
+		void setActiveCurve(Size index)
+		{
+			if (!registry_.contains(index)) {
+				throw std::runtime_error("Curve index " + std::to_string(index) + " not found");
+			}
+
+			const CurveRegistry::Entry& entry = registry_[index];
+			active_id_ = registry_.id(index);
+			active_curve_ptr_ = entry.curve;
+			if (!frozen_) {
+				active_curve_.linkTo(entry.curve);
+			}
+			active_curve_up_ = entry.curve_up;
+			active_curve_down_ = entry.curve_down;
 		}
 
 		std::shared_ptr<YieldTermStructure> activeCurve() const 
 		{
-			return *active_curve_;
+			return active_curve_ptr_;
 		}
 		std::string activeCurveName() const 
 		{
-			return active_curve_name_;
+			if (!active_curve_ptr_) {
+				return "";
+			}
+			return registry_.name(active_id_);
+		}
+		// Interning a new base or method moves curves, so the index is recomputed from the active id
+		Size activeCurveIndex() const
+		{
+			return registry_.index(active_id_);
 		}
 
+		const CurveRegistry& registry() const
+		{
+			return registry_;
+		}
+
+		// Frozen valuation prices bonds directly, so bonds are not attached to the engine
 		void linkToActiveCurve(const std::shared_ptr<Bond>& bond) const 
 		{
-			bond->setPricingEngine(bond_engine_);
+			if (!frozen_) {
+				bond->setPricingEngine(bond_engine_);
+			}
 		}
 
 		Real NPV(const std::shared_ptr<Bond>& bond) const 
 		{
+			if (frozen_) {
+				return discountedValue(*bond, *active_curve_ptr_);
+			}
 			return bond->NPV();
 		}
 
 		Real NPV(const Leg& leg) const 
 		{
-			//std::cout << active_curve_->referenceDate() << "\n";
-			return CashFlows::npv(leg, **active_curve_, false);
+			return discountedValue(leg, *active_curve_ptr_);
 		}
 
 		Real duration(const std::shared_ptr<Bond>& bond) {
+			if (frozen_) {
+				Real base = discountedValue(*bond, *active_curve_ptr_);
+				Real up = discountedValue(*bond, *active_curve_up_);
+				Real down = discountedValue(*bond, *active_curve_down_);
+				return effectiveDuration(base, up, down, spread_up_->value());
+			}
+
 			std::shared_ptr<YieldTermStructure> curve_base = *active_curve_;
 			Real base = bond->NPV();
 			active_curve_.linkTo(active_curve_up_);
@@ -75,21 +153,28 @@ namespace ACHS {
 			Real down = bond->NPV();
 			active_curve_.linkTo(curve_base);
 
-			return -(up - down) / (2.0 * base * spread_up_->value());
+			return effectiveDuration(base, up, down, spread_up_->value());
 
 		}
 
 		Real duration(const Leg& leg) {
-			Real base = CashFlows::npv(leg, **active_curve_, false);
-			Real up = CashFlows::npv(leg, *active_curve_up_, false);
-			Real down = CashFlows::npv(leg, *active_curve_down_, false);
+			Real base = discountedValue(leg, *active_curve_ptr_);
+			Real up = discountedValue(leg, *active_curve_up_);
+			Real down = discountedValue(leg, *active_curve_down_);
 
-			return -(up - down) / (2.0 * base * spread_up_->value());
+			return effectiveDuration(base, up, down, spread_up_->value());
 
 		}
 
 
 		Real convexity(const std::shared_ptr<Bond>& bond) {
+			if (frozen_) {
+				Real base = discountedValue(*bond, *active_curve_ptr_);
+				Real up = discountedValue(*bond, *active_curve_up_);
+				Real down = discountedValue(*bond, *active_curve_down_);
+				return effectiveConvexity(base, up, down, spread_up_->value());
+			}
+
 			std::shared_ptr<YieldTermStructure> curve_base = *active_curve_;
 
 			Real base = bond->NPV();
@@ -99,24 +184,49 @@ namespace ACHS {
 			Real down = bond->NPV();
 			active_curve_.linkTo(curve_base);
 
-			return (up + down - 2.0 * base) / (base * spread_up_->value() * spread_up_->value());
+			return effectiveConvexity(base, up, down, spread_up_->value());
 
 		}
 
 		Real convexity(const Leg& leg) {
-			Real base = CashFlows::npv(leg, **active_curve_, false);
-			Real up = CashFlows::npv(leg, *active_curve_up_, false);
-			Real down = CashFlows::npv(leg, *active_curve_down_, false);
+			Real base = discountedValue(leg, *active_curve_ptr_);
+			Real up = discountedValue(leg, *active_curve_up_);
+			Real down = discountedValue(leg, *active_curve_down_);
+
+			return effectiveConvexity(base, up, down, spread_up_->value());
 
-			return (up + down - 2.0 * base) / (base * spread_up_->value() * spread_up_->value());
+		}
 
+		// Switches to frozen valuation: the extended and spread curves this set owns are detached from the
+		// observer graph, the active curve is no longer relinked, and bonds are priced directly on the curves
+		// instead of through the pricing engine. Extended curves read their base before the extension start,
+		// so lazy base curves are calculated and frozen too; bases that are not lazy objects, such as
+		// interpolated curves, are taken to be fixed. Nothing in a frozen set sees market updates, and neither
+		// does any other user of its bases, so build separate bases for curves that must stay live. Curves
+		// added later are frozen as they are added, and freezing cannot be undone.
+		void freeze()
+		{
+			frozen_ = true;
+			for (Size i = 0; i < registry_.size(); ++i) {
+				if (registry_.contains(i)) {
+					detach(registry_[i]);
+				}
+			}
+		}
+
+		bool frozen() const
+		{
+			return frozen_;
 		}
 
 	private:
-		std::map<std::string, std::shared_ptr<ExtendedCurveWrapper>> curve_map_;
+		CurveRegistry registry_;
 
-		std::string active_curve_name_;
+		// Ids stay valid when the registry is re-laid out; flat indices do not
+		CurveId active_id_{ 0, 0, 0 };
 		RelinkableHandle<YieldTermStructure> active_curve_;
+		std::shared_ptr<YieldTermStructure> active_curve_ptr_;
+		bool frozen_ = false;
 
 		Handle<Quote> spread_up_;
 		Handle<Quote> spread_down_;
@@ -124,5 +234,30 @@ namespace ACHS {
 		std::shared_ptr<YieldTermStructure> active_curve_down_;
 
 		std::shared_ptr<DiscountingBondEngine> bond_engine_;
+
+		void add(const CurveId& id, const std::shared_ptr<ExtendedCurveWrapper>& wrapper)
+		{
+			registry_.addOrUpdate(id, wrapper);
+			if (frozen_) {
+				detach(registry_.at(id));
+			}
+			// Replacing the active curve activates its replacement
+			if (active_curve_ptr_ && registry_.index(id) == registry_.index(active_id_)) {
+				setActiveCurve(id);
+			}
+		}
+
+		void detach(const CurveRegistry::Entry& entry) const
+		{
+			if (std::shared_ptr<YieldTermStructure> base = entry.wrapper->base()) {
+				base->discount(0.0);
+				if (auto lazy = std::dynamic_pointer_cast<LazyObject>(base)) {
+					lazy->freeze();
+				}
+			}
+			entry.curve->unregisterWithAll();
+			entry.curve_up->unregisterWithAll();
+			entry.curve_down->unregisterWithAll();
+		}
 	};
 }
\ No newline at end of file
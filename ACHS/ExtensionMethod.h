@@ -1,6 +1,8 @@
 #pragma once
+#include "DiscountAdjoint.h"
 #include <ql/quantlib.hpp>
 #include <algorithm>
+#include <cmath>
 #include <vector>
 namespace ACHS {
 	namespace Traits {
@@ -10,6 +12,13 @@ namespace ACHS {
 
 	using namespace QuantLib;
 
+	// Extended tails are built from annually compounded rates, as extractRate returns them. Ultimate rates
+	// supplied by the user are continuously compounded, as the ZeroCurve and ForwardCurve tails of earlier
+	// versions read them, and are converted with this before use.
+	inline Rate annualFromContinuous(Rate continuous_rate) {
+		return std::exp(continuous_rate) - 1.0;
+	}
+
 	template<typename Trait>
 	QuantLib::Rate extractRate(const  std::shared_ptr<YieldTermStructure>& curve, QuantLib::Time t);
 
@@ -23,6 +32,29 @@ namespace ACHS {
 		return curve->forwardRate(t, t + 1.0 / 365.0, Compounded).rate();
 	}
 
+	// Adds rate_adjoint * dr/dD(t) to the base adjoint for the rate r returned by extractRate
+	template<typename Trait>
+	void extractRateAdjoint(const std::shared_ptr<YieldTermStructure>& curve, QuantLib::Time t, Real rate_adjoint, DiscountAdjoint& adjoint);
+
+	template<>
+	void extractRateAdjoint<Traits::Zero>(const std::shared_ptr<YieldTermStructure>& curve, QuantLib::Time t, Real rate_adjoint, DiscountAdjoint& adjoint) {
+		// r = D(t)^(-1/t) - 1
+		DiscountFactor d = curve->discount(t);
+		Rate r = std::pow(d, -1.0 / t) - 1.0;
+		adjoint.add(t, -rate_adjoint * (1.0 + r) / (t * d));
+	}
+
+	template<>
+	void extractRateAdjoint<Traits::Forward>(const std::shared_ptr<YieldTermStructure>& curve, QuantLib::Time t, Real rate_adjoint, DiscountAdjoint& adjoint) {
+		// r = (D(t) / D(t + h))^(1/h) - 1
+		Time h = 1.0 / 365.0;
+		DiscountFactor d1 = curve->discount(t);
+		DiscountFactor d2 = curve->discount(t + h);
+		Rate r = std::pow(d1 / d2, 1.0 / h) - 1.0;
+		adjoint.add(t, rate_adjoint * (1.0 + r) / (h * d1));
+		adjoint.add(t + h, -rate_adjoint * (1.0 + r) / (h * d2));
+	}
+
 	template<typename Derived, typename Trait>
 	class ExtensionMethod {
 	public:
@@ -31,9 +63,23 @@ namespace ACHS {
 		{
 			return static_cast<const Derived*>(this)->buildCurveImpl(base);
 		}
+
+		// Reverse sweep through buildCurve: given the adjoint of an output with respect to the discount
+		// factors of curve, as built from base, accumulates its adjoint with respect to base's discount factors
+		void adjoint(
+			const std::shared_ptr<YieldTermStructure>& base,
+			const YieldTermStructure& curve,
+			const DiscountAdjoint& curve_adjoint,
+			DiscountAdjoint& base_adjoint) const
+		{
+			static_cast<const Derived*>(this)->adjointImpl(base, curve, curve_adjoint, base_adjoint);
+		}
 	protected:
 		Period start_period_;
 		Period end_period_;
+		// Sampling grid of RollingAverage and spacing of the Smith-Wilson liquid points. Methods whose tail
+		// is evaluated in closed form ignore it; they still accept it so that every method keeps the same
+		// constructor arguments.
 		Period step_;
 
 		ExtensionMethod(
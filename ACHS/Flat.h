@@ -1,5 +1,6 @@
 #pragma once
 #include "ExtensionMethod.h"
+#include "HybridCurve.h"
 #include <ql/quantlib.hpp>
 #include <algorithm>
 #include <vector>
@@ -7,6 +8,7 @@ namespace ACHS {
 
 	using namespace QuantLib;
 
+	// Holds the base rate at the start period flat to the end period.
 	template<typename Trait>
 	class Flat : public ExtensionMethod<Flat<Trait>, Trait> {
 		friend class ExtensionMethod<Flat<Trait>, Trait>;
@@ -21,42 +23,35 @@ namespace ACHS {
 		std::shared_ptr<YieldTermStructure> buildCurveImpl(
 			const std::shared_ptr<YieldTermStructure>& base) const {
 
+			return std::make_shared<HybridCurve<Trait>>(
+				base,
+				base->referenceDate() + this->end_period_,
+				[method = *this](const std::shared_ptr<YieldTermStructure>& b) { return method.tail(b); });
+		}
+
+		typename HybridCurve<Trait>::Tail tail(
+			const std::shared_ptr<YieldTermStructure>& base) const {
+
 			DayCounter day_counter = base->dayCounter();
 
 			Date reference_date = base->referenceDate();
 
 			Date start_date = reference_date + this->start_period_;
-			Date end_date = reference_date + this->end_period_;
 
 			Time start_time = day_counter.yearFraction(reference_date, start_date);
-			Time end_time = day_counter.yearFraction(reference_date, end_date);
 
-			std::vector<Date> dates;
-			std::vector<Rate> rates;
-
-			for (Date d = reference_date; d <= end_date; d += this->step_) {
-				Time t = day_counter.yearFraction(reference_date, d);
-				Rate r = (t < start_time) ? extractRate<Trait>(base, t) : extractRate<Trait>(base, start_time);
-
-				dates.push_back(d);
-				rates.push_back(r);
-			}
+			return { { start_time }, { extractRate<Trait>(base, start_time) } };
+		}
 
-			for (std::size_t i = 1; i < dates.size(); ++i) {
-				if (dates[i] == dates[i - 1]) {
-					std::cerr << "Duplicate date: " << dates[i] << std::endl;
-				}
-			}
+		void adjointImpl(
+			const std::shared_ptr<YieldTermStructure>& base,
+			const YieldTermStructure& curve,
+			const DiscountAdjoint& curve_adjoint,
+			DiscountAdjoint& base_adjoint) const {
 
-			if constexpr (std::is_same_v<Trait, Traits::Zero>) {
-				return std::make_shared<ZeroCurve>(dates, rates, day_counter);
-			}
-			else if constexpr (std::is_same_v<Trait, Traits::Forward>) {
-				return std::make_shared<ForwardCurve>(dates, rates, day_counter);
-			}
-			else {
-				throw std::runtime_error("Flat::buildCurveImpl: unknown trait.");
-			}
+			const auto& hybrid = dynamic_cast<const HybridCurve<Trait>&>(curve);
+			std::vector<Real> rate_adjoints = hybrid.adjoint(curve_adjoint, base_adjoint);
+			extractRateAdjoint<Trait>(base, hybrid.startTime(), rate_adjoints.front(), base_adjoint);
 		}
 
 	};
@@ -0,0 +1,197 @@
+#pragma once
+#include "ExtensionMethod.h"
+#include <ql/quantlib.hpp>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <vector>
+namespace ACHS {
+
+	using namespace QuantLib;
+
+	// Extended curve that delegates to the base curve before the extension start and evaluates a compact
+	// tail afterwards. The tail is a piecewise-linear zero (Traits::Zero) or instantaneous forward
+	// (Traits::Forward) rate through the given nodes, held flat beyond the first and last node; the first
+	// node time is the extension start. Tail rates are given annually compounded, as returned by
+	// extractRate, and interpolated as log(1 + r), their continuously compounded equivalents, so that a flat
+	// tail joins the base curve without a jump. The extension method supplies the tail as a function of the
+	// base, which is called again whenever the base changes, so the tail always matches the base it joins.
+	template<typename Trait>
+	class HybridCurve : public YieldTermStructure, public LazyObject {
+	public:
+		// Tail nodes: times from the reference date and annually compounded rates
+		struct Tail {
+			std::vector<Time> times;
+			std::vector<Rate> rates;
+		};
+
+		using TailBuilder = std::function<Tail(const std::shared_ptr<YieldTermStructure>&)>;
+
+		HybridCurve(
+			const std::shared_ptr<YieldTermStructure>& base,
+			const Date& max_date,
+			TailBuilder tail) :
+			YieldTermStructure(base->referenceDate(), Calendar(), base->dayCounter()),
+			base_(base), max_date_(max_date), tail_(std::move(tail)) {
+
+			registerWith(base_);
+			// Built now, so that an invalid tail is reported by the extension method
+			calculate();
+		}
+
+		Date maxDate() const override {
+			return max_date_;
+		}
+
+		void update() override {
+			LazyObject::update();
+			YieldTermStructure::update();
+		}
+
+		const std::shared_ptr<YieldTermStructure>& base() const {
+			return base_;
+		}
+
+		Time startTime() const {
+			calculate();
+			return tail_times_.front();
+		}
+
+		const std::vector<Time>& tailTimes() const {
+			calculate();
+			return tail_times_;
+		}
+
+		// Continuously compounded tail rates
+		const std::vector<Rate>& tailRates() const {
+			calculate();
+			return tail_rates_;
+		}
+
+		// Index k of the tail segment containing t and the weight of node k + 1 within it
+		std::pair<std::size_t, Real> locate(Time t) const {
+			calculate();
+			if (t <= tail_times_.front()) {
+				return { 0, 0.0 };
+			}
+			if (t >= tail_times_.back()) {
+				return { tail_times_.size() - 1, 0.0 };
+			}
+			std::size_t k = std::upper_bound(tail_times_.begin(), tail_times_.end(), t) - tail_times_.begin() - 1;
+			return { k, (t - tail_times_[k]) / (tail_times_[k + 1] - tail_times_[k]) };
+		}
+
+		// Reverse sweep through discountImpl: accumulates the base curve's share of curve_adjoint into
+		// base_adjoint and returns the adjoints with respect to the annually compounded tail rates
+		std::vector<Real> adjoint(const DiscountAdjoint& curve_adjoint, DiscountAdjoint& base_adjoint) const {
+			calculate();
+			std::size_t n = tail_rates_.size();
+			std::vector<Real> rate_adjoints(n, 0.0);
+			std::vector<Real> cumulative_adjoints(n, 0.0);
+
+			// Spreads an adjoint of the interpolated rate at (k, w) onto the nodes
+			auto spread = [&](std::size_t k, Real w, Real adjoint) {
+				if (k + 1 < n) {
+					rate_adjoints[k] += adjoint * (1.0 - w);
+					rate_adjoints[k + 1] += adjoint * w;
+				}
+				else {
+					rate_adjoints[k] += adjoint;
+				}
+			};
+
+			for (const auto& [t, d_adjoint] : curve_adjoint) {
+				if (t < tail_times_.front()) {
+					base_adjoint.add(t, d_adjoint);
+					continue;
+				}
+
+				auto [k, w] = locate(t);
+				DiscountFactor d = discountImpl(t);
+
+				if constexpr (std::is_same_v<Trait, Traits::Zero>) {
+					spread(k, w, -d_adjoint * t * d);
+				}
+				else if constexpr (std::is_same_v<Trait, Traits::Forward>) {
+					base_adjoint.add(tail_times_.front(), d_adjoint * d / base_->discount(tail_times_.front()));
+
+					Real integral_adjoint = -d_adjoint * d;
+					cumulative_adjoints[k] += integral_adjoint;
+					rate_adjoints[k] += 0.5 * (t - tail_times_[k]) * integral_adjoint;
+					spread(k, w, 0.5 * (t - tail_times_[k]) * integral_adjoint);
+				}
+				else {
+					throw std::runtime_error("HybridCurve::adjoint: unknown trait.");
+				}
+			}
+
+			// Segment m enters the cumulative integral of every node after it
+			Real running = 0.0;
+			for (std::size_t k = n - 1; k > 0; --k) {
+				running += cumulative_adjoints[k];
+				Real half = 0.5 * (tail_times_[k] - tail_times_[k - 1]) * running;
+				rate_adjoints[k - 1] += half;
+				rate_adjoints[k] += half;
+			}
+
+			// Rates are interpolated as log(1 + r)
+			for (std::size_t k = 0; k < n; ++k) {
+				rate_adjoints[k] *= std::exp(-tail_rates_[k]);
+			}
+			return rate_adjoints;
+		}
+
+	protected:
+		void performCalculations() const override {
+			Tail tail = tail_(base_);
+			if (tail.times.empty() || tail.times.size() != tail.rates.size()) {
+				throw std::runtime_error("HybridCurve: tail times and rates must be non-empty and of equal size.");
+			}
+
+			tail_times_ = std::move(tail.times);
+			tail_rates_.clear();
+			for (Rate r : tail.rates) {
+				tail_rates_.push_back(std::log(1.0 + r));
+			}
+
+			// Integrated forward from the start time to each node, used by the forward tail
+			cumulative_.assign(1, 0.0);
+			for (std::size_t k = 1; k < tail_times_.size(); ++k) {
+				cumulative_.push_back(cumulative_.back()
+					+ 0.5 * (tail_rates_[k - 1] + tail_rates_[k]) * (tail_times_[k] - tail_times_[k - 1]));
+			}
+		}
+
+		DiscountFactor discountImpl(Time t) const override {
+			calculate();
+			if (t < tail_times_.front()) {
+				return base_->discount(t);
+			}
+
+			auto [k, w] = locate(t);
+			Rate r = (k + 1 < tail_rates_.size())
+				? tail_rates_[k] * (1.0 - w) + tail_rates_[k + 1] * w
+				: tail_rates_[k];
+
+			if constexpr (std::is_same_v<Trait, Traits::Zero>) {
+				return std::exp(-r * t);
+			}
+			else if constexpr (std::is_same_v<Trait, Traits::Forward>) {
+				Real integral = cumulative_[k] + 0.5 * (tail_rates_[k] + r) * (t - tail_times_[k]);
+				return base_->discount(tail_times_.front()) * std::exp(-integral);
+			}
+			else {
+				throw std::runtime_error("HybridCurve::discountImpl: unknown trait.");
+			}
+		}
+
+	private:
+		std::shared_ptr<YieldTermStructure> base_;
+		Date max_date_;
+		TailBuilder tail_;
+		mutable std::vector<Time> tail_times_;
+		mutable std::vector<Rate> tail_rates_;
+		mutable std::vector<Real> cumulative_;
+	};
+
+}
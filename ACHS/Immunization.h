@@ -0,0 +1,284 @@
+#pragma once
+#include "CurveRegistry.h"
+#include <ql/quantlib.hpp>
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <string>
+#include <vector>
+namespace ACHS {
+
+	using namespace QuantLib;
+
+	// Sensitivities of a candidate asset universe and of the liabilities to each of a set of curves,
+	// computed once so that hedge weights can be solved without repricing. For every curve the metrics are
+	// value, dollar duration and dollar convexity under a parallel continuously compounded zero-rate shift,
+	// followed by one key-rate dollar duration per key time (triangular weights that sum to one). These are
+	// the analytic limits of the effective measures used by ExtendedCurves.
+	class SensitivityMatrix {
+	public:
+		static constexpr Size value = 0;
+		static constexpr Size dollar_duration = 1;
+		static constexpr Size dollar_convexity = 2;
+		static constexpr Size first_key_rate = 3;
+
+		SensitivityMatrix(
+			std::vector<std::shared_ptr<Bond>> candidates,
+			Leg liabilities,
+			Size curves,
+			std::vector<Time> key_rate_times = {}) :
+			candidates_(std::move(candidates)), liabilities_(std::move(liabilities)), curves_(curves),
+			key_rate_times_(std::move(key_rate_times)) {
+
+			if (!std::is_sorted(key_rate_times_.begin(), key_rate_times_.end())) {
+				throw std::runtime_error("SensitivityMatrix: key-rate times must be increasing.");
+			}
+			candidate_metrics_.assign(candidates_.size() * rows(), 0.0);
+			liability_metrics_.assign(rows(), 0.0);
+		}
+
+		// Every curve of a registry, in index order
+		SensitivityMatrix(
+			std::vector<std::shared_ptr<Bond>> candidates,
+			Leg liabilities,
+			const CurveRegistry& registry,
+			std::vector<Time> key_rate_times = {}) :
+			SensitivityMatrix(std::move(candidates), std::move(liabilities), 0, std::move(key_rate_times)) {
+
+			std::vector<Size> indices;
+			for (Size i = 0; i < registry.size(); ++i) {
+				if (registry.contains(i)) {
+					indices.push_back(i);
+				}
+			}
+			curves_ = indices.size();
+			candidate_metrics_.assign(candidates_.size() * rows(), 0.0);
+			liability_metrics_.assign(rows(), 0.0);
+			for (Size c = 0; c < indices.size(); ++c) {
+				setCurve(c, *registry[indices[c]].curve);
+			}
+		}
+
+		// Fills the rows of one curve. Different curves may be set concurrently.
+		void setCurve(Size c, const YieldTermStructure& curve) {
+			if (c >= curves_) {
+				throw std::runtime_error("SensitivityMatrix::setCurve: curve " + std::to_string(c) + " out of range.");
+			}
+			std::vector<Real> metrics(metricCount());
+
+			// As discountedValue: bonds on the curve's reference date, the liabilities on the evaluation date
+			bool include = Settings::instance().includeReferenceDateEvents();
+			for (Size i = 0; i < candidates_.size(); ++i) {
+				measure(candidates_[i]->cashflows(), curve.referenceDate(), include, curve, metrics);
+				std::copy(metrics.begin(), metrics.end(), candidate_metrics_.begin() + i * rows() + c * metricCount());
+			}
+			measure(liabilities_, Settings::instance().evaluationDate(), false, curve, metrics);
+			std::copy(metrics.begin(), metrics.end(), liability_metrics_.begin() + c * metricCount());
+		}
+
+		Size candidates() const {
+			return candidates_.size();
+		}
+
+		Size curves() const {
+			return curves_;
+		}
+
+		Size metricCount() const {
+			return first_key_rate + key_rate_times_.size();
+		}
+
+		// Rows of the system: one per (curve, metric)
+		Size rows() const {
+			return curves_ * metricCount();
+		}
+
+		const std::vector<Time>& keyRateTimes() const {
+			return key_rate_times_;
+		}
+
+		Real candidate(Size instrument, Size curve, Size metric) const {
+			return candidate_metrics_[instrument * rows() + curve * metricCount() + metric];
+		}
+
+		Real liability(Size curve, Size metric) const {
+			return liability_metrics_[curve * metricCount() + metric];
+		}
+
+		// All rows of one candidate, contiguous
+		const Real* column(Size instrument) const {
+			return candidate_metrics_.data() + instrument * rows();
+		}
+
+		const std::vector<Real>& liabilities() const {
+			return liability_metrics_;
+		}
+
+	private:
+		std::vector<std::shared_ptr<Bond>> candidates_;
+		Leg liabilities_;
+		Size curves_;
+		std::vector<Time> key_rate_times_;
+
+		// Candidate-major: the rows of candidate i start at i * rows()
+		std::vector<Real> candidate_metrics_;
+		std::vector<Real> liability_metrics_;
+
+		void measure(const Leg& flows, const Date& settlement, bool include, const YieldTermStructure& curve, std::vector<Real>& metrics) const {
+			std::fill(metrics.begin(), metrics.end(), 0.0);
+			for (const std::shared_ptr<CashFlow>& cf : flows) {
+				if (cf->hasOccurred(settlement, include) || cf->tradingExCoupon(settlement)) {
+					continue;
+				}
+				Time t = curve.timeFromReference(cf->date());
+				Real pv = cf->amount() * curve.discount(t);
+				metrics[value] += pv;
+				metrics[dollar_duration] += pv * t;
+				metrics[dollar_convexity] += pv * t * t;
+				addKeyRates(t, pv * t, metrics);
+			}
+		}
+
+		void addKeyRates(Time t, Real dollar_duration_t, std::vector<Real>& metrics) const {
+			Size n = key_rate_times_.size();
+			if (n == 0) {
+				return;
+			}
+			if (t <= key_rate_times_.front()) {
+				metrics[first_key_rate] += dollar_duration_t;
+				return;
+			}
+			if (t >= key_rate_times_.back()) {
+				metrics[first_key_rate + n - 1] += dollar_duration_t;
+				return;
+			}
+			Size k = std::upper_bound(key_rate_times_.begin(), key_rate_times_.end(), t) - key_rate_times_.begin() - 1;
+			Real w = (t - key_rate_times_[k]) / (key_rate_times_[k + 1] - key_rate_times_[k]);
+			metrics[first_key_rate + k] += dollar_duration_t * (1.0 - w);
+			metrics[first_key_rate + k + 1] += dollar_duration_t * w;
+		}
+	};
+
+	struct ImmunizationOptions {
+		// Weight of each metric (value, dollar duration, dollar convexity, key rates); zero drops it. Missing
+		// entries default to one for the first three metrics and zero for key rates.
+		std::vector<Real> metric_weights;
+		// Ridge penalty on the column-normalized weights, which keeps the problem well posed when candidates
+		// are nearly collinear
+		Real ridge = 1.0e-8;
+		bool non_negative = true;
+		Size max_sweeps = 1000;
+		Real tolerance = 1.0e-10;
+	};
+
+	struct ImmunizationResult {
+		std::vector<Real> weights;
+		// Weighted residual of each row relative to the liability metric
+		std::vector<Real> relative_errors;
+		Real rms_error;
+		Size sweeps;
+		// False when max_sweeps ran out before the largest weight step fell within tolerance; the weights
+		// are then the last iterate, not a solution
+		bool converged;
+	};
+
+	// Chooses candidate weights so that the portfolio's metrics match the liabilities' across all curves at
+	// once, in weighted least squares with each row scaled by the liability metric. Solved by (projected)
+	// coordinate descent on the column-normalized system, which touches one candidate column at a time and
+	// needs no normal matrix, so thousands of candidates solve in O(rows x candidates) per sweep.
+	inline ImmunizationResult immunize(const SensitivityMatrix& matrix, const ImmunizationOptions& options = {}) {
+		Size rows = matrix.rows();
+		Size n = matrix.candidates();
+		Size metrics = matrix.metricCount();
+
+		// Row scales: metric weight over the magnitude of the liability target
+		std::vector<Real> scale(rows, 0.0);
+		std::vector<Real> target(rows, 0.0);
+		for (Size r = 0; r < rows; ++r) {
+			Size m = r % metrics;
+			Real weight = m < options.metric_weights.size() ? options.metric_weights[m]
+				: (m < SensitivityMatrix::first_key_rate ? 1.0 : 0.0);
+			Real liability = matrix.liabilities()[r];
+			scale[r] = (weight == 0.0 || liability == 0.0) ? 0.0 : weight / std::abs(liability);
+			target[r] = scale[r] * liability;
+		}
+
+		// Scaled, column-normalized candidate columns
+		std::vector<Real> columns(rows * n);
+		std::vector<Real> norms(n, 0.0);
+		for (Size j = 0; j < n; ++j) {
+			const Real* column = matrix.column(j);
+			Real* scaled = columns.data() + j * rows;
+			for (Size r = 0; r < rows; ++r) {
+				scaled[r] = scale[r] * column[r];
+				norms[j] += scaled[r] * scaled[r];
+			}
+			norms[j] = std::sqrt(norms[j]);
+			if (norms[j] > 0.0) {
+				for (Size r = 0; r < rows; ++r) {
+					scaled[r] /= norms[j];
+				}
+			}
+		}
+
+		std::vector<Real> x(n, 0.0);
+		std::vector<Real> residual = target;
+		Real target_norm = std::sqrt(std::inner_product(target.begin(), target.end(), target.begin(), 0.0));
+
+		Size sweep = 0;
+		bool converged = false;
+		for (; sweep < options.max_sweeps; ++sweep) {
+			Real largest_step = 0.0;
+			for (Size j = 0; j < n; ++j) {
+				if (norms[j] == 0.0) {
+					continue;
+				}
+				const Real* a = columns.data() + j * rows;
+				Real correlation = 0.0;
+				for (Size r = 0; r < rows; ++r) {
+					correlation += a[r] * residual[r];
+				}
+				// Columns have unit norm, so the coordinate minimizer is (a'r + x_j) / (1 + ridge)
+				Real updated = (correlation + x[j]) / (1.0 + options.ridge);
+				if (options.non_negative) {
+					updated = std::max(updated, 0.0);
+				}
+				Real step = updated - x[j];
+				if (step != 0.0) {
+					for (Size r = 0; r < rows; ++r) {
+						residual[r] -= step * a[r];
+					}
+					x[j] = updated;
+					largest_step = std::max(largest_step, std::abs(step));
+				}
+			}
+			if (largest_step <= options.tolerance * std::max(target_norm, 1.0)) {
+				++sweep;
+				converged = true;
+				break;
+			}
+		}
+
+		ImmunizationResult result;
+		result.sweeps = sweep;
+		result.converged = converged;
+		result.weights.resize(n);
+		for (Size j = 0; j < n; ++j) {
+			result.weights[j] = norms[j] > 0.0 ? x[j] / norms[j] : 0.0;
+		}
+
+		Real sum_squares = 0.0;
+		Size active = 0;
+		result.relative_errors.assign(rows, 0.0);
+		for (Size r = 0; r < rows; ++r) {
+			if (scale[r] != 0.0) {
+				result.relative_errors[r] = -residual[r];
+				sum_squares += residual[r] * residual[r];
+				++active;
+			}
+		}
+		result.rms_error = active > 0 ? std::sqrt(sum_squares / active) : 0.0;
+		return result;
+	}
+
+}
@@ -1,5 +1,6 @@
 #pragma once
 #include "ExtensionMethod.h"
+#include "HybridCurve.h"
 #include <ql/quantlib.hpp>
 #include <algorithm>
 #include <vector>
@@ -7,6 +8,8 @@ namespace ACHS {
 
 	using namespace QuantLib;
 
+	// Grades linearly from the base rate at the start period to a continuously compounded ultimate rate at
+	// grading_end_period, and holds it to the end period.
 	template<typename Trait>
 	class LinearlyGraded : public ExtensionMethod<LinearlyGraded<Trait>, Trait> {
 		friend class ExtensionMethod<LinearlyGraded<Trait>, Trait>;
@@ -17,55 +20,59 @@ namespace ACHS {
 			const Period& grading_end_period,
 			const Period& end_period,
 			const Period& step = Period(1, Months)) :
-			ultimate_rate_(ultimate_rate), grading_end_period_(grading_end_period),
-			ExtensionMethod<LinearlyGraded<Trait>, Trait>(start_period, end_period, step) {}
+			ExtensionMethod<LinearlyGraded<Trait>, Trait>(start_period, end_period, step),
+			ultimate_rate_(ultimate_rate), grading_end_period_(grading_end_period) {}
 
 	protected:
 		std::shared_ptr<YieldTermStructure> buildCurveImpl(
 			const std::shared_ptr<YieldTermStructure>& base) const {
 
+			return std::make_shared<HybridCurve<Trait>>(
+				base,
+				base->referenceDate() + this->end_period_,
+				[method = *this](const std::shared_ptr<YieldTermStructure>& b) { return method.tail(b); });
+		}
+
+		typename HybridCurve<Trait>::Tail tail(
+			const std::shared_ptr<YieldTermStructure>& base) const {
+
 			DayCounter day_counter = base->dayCounter();
 
 			Date reference_date = base->referenceDate();
 
 			Date start_date = reference_date + this->start_period_;
 			Date grading_end_date = reference_date + grading_end_period_;
-			Date end_date = reference_date + this->end_period_;
 
 			Time start_time = day_counter.yearFraction(reference_date, start_date);
 			Time grading_end_time = day_counter.yearFraction(reference_date, grading_end_date);
-			Time end_time = day_counter.yearFraction(reference_date, end_date);
-
-			std::vector<Date> dates;
-			std::vector<Rate> rates;
-
-			for (Date d = reference_date; d <= end_date; d += this->step_) {
-				Time t = day_counter.yearFraction(reference_date, d);
-				Rate r;
-				if (t < start_time) {
-					r = extractRate<Trait>(base, t);
-				}
-				else if (t <= grading_end_time) {
-					Rate r_start = extractRate<Trait>(base, start_time);
-					Real w = std::clamp((t - start_time) / (grading_end_time - start_time), 0.0, 1.0);
-					r = r_start * (1 - w) + ultimate_rate_ * w;
-				}
-				else {
-					r = ultimate_rate_;
-				}
-
-				dates.push_back(d);
-				rates.push_back(r);
-			}
 
-			if constexpr (std::is_same_v<Trait, Traits::Zero>) {
-				return std::make_shared<ZeroCurve>(dates, rates, day_counter);
-			}
-			else if constexpr (std::is_same_v<Trait, Traits::Forward>) {
-				return std::make_shared<ForwardCurve>(dates, rates, day_counter);
+			std::vector<Time> times{ start_time };
+			std::vector<Rate> rates{ extractRate<Trait>(base, start_time) };
+
+			// Linear ramp from the base rate at the start to the ultimate rate at the end of grading
+			if (grading_end_time > start_time) {
+				times.push_back(grading_end_time);
+				rates.push_back(annualFromContinuous(ultimate_rate_));
 			}
 			else {
-				throw std::runtime_error("LinearlyGraded::buildCurveImpl: unknown trait.");
+				rates.back() = annualFromContinuous(ultimate_rate_);
+			}
+
+			return { times, rates };
+		}
+
+		void adjointImpl(
+			const std::shared_ptr<YieldTermStructure>& base,
+			const YieldTermStructure& curve,
+			const DiscountAdjoint& curve_adjoint,
+			DiscountAdjoint& base_adjoint) const {
+
+			const auto& hybrid = dynamic_cast<const HybridCurve<Trait>&>(curve);
+			std::vector<Real> rate_adjoints = hybrid.adjoint(curve_adjoint, base_adjoint);
+
+			// Without a grading period the only node is the ultimate rate
+			if (hybrid.tailTimes().size() > 1) {
+				extractRateAdjoint<Trait>(base, hybrid.startTime(), rate_adjoints.front(), base_adjoint);
 			}
 		}
 	private:
@@ -0,0 +1,234 @@
+#pragma once
+#include "ExtensionMethod.h"
+#include "HybridCurve.h"
+#include "Valuation.h"
+#include <ql/quantlib.hpp>
+#include <algorithm>
+#include <cmath>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+namespace ACHS {
+
+	using namespace QuantLib;
+
+	// Delegates to a base curve and remembers its discount factors by time, so that extensions built on it
+	// sample the base only once for all the times they have in common. Always extrapolates, reading the
+	// base with extrapolation forced rather than changing the base's own setting. The cache keeps every
+	// distinct time read until the base changes and is filled from const calls without locking, so a
+	// MemoizedCurve must be read from one thread at a time.
+	class MemoizedCurve : public YieldTermStructure {
+	public:
+		explicit MemoizedCurve(const std::shared_ptr<YieldTermStructure>& base) :
+			YieldTermStructure(base->referenceDate(), base->calendar(), base->dayCounter()), base_(base) {
+
+			enableExtrapolation();
+			registerWith(base_);
+		}
+
+		Date maxDate() const override {
+			return base_->maxDate();
+		}
+
+		void update() override {
+			cache_.clear();
+			YieldTermStructure::update();
+		}
+
+	protected:
+		DiscountFactor discountImpl(Time t) const override {
+			auto [it, inserted] = cache_.try_emplace(t, 0.0);
+			if (inserted) {
+				it->second = base_->discount(t, true);
+			}
+			return it->second;
+		}
+
+	private:
+		std::shared_ptr<YieldTermStructure> base_;
+		mutable std::unordered_map<Time, DiscountFactor> cache_;
+	};
+
+	// Portfolio metrics under one extension
+	struct SweepPoint {
+		Real asset_value;
+		Real asset_duration;
+		Real asset_convexity;
+		Real liability_value;
+		Real liability_duration;
+		Real liability_convexity;
+		Real surplus;
+	};
+
+	// Cartesian product of parameter axes, the last axis varying fastest
+	template<typename... Args>
+	std::vector<std::tuple<Args...>> parameterGrid(const std::vector<Args>&... axes) {
+		Size total = (Size(1) * ... * axes.size());
+		std::vector<std::tuple<Args...>> points;
+		points.reserve(total);
+		for (Size n = 0; n < total; ++n) {
+			Size stride = total;
+			auto pick = [&](const auto& axis) {
+				stride /= axis.size();
+				return axis[(n / stride) % axis.size()];
+			};
+			// Braced initializers are evaluated left to right
+			points.push_back(std::tuple<Args...>{ pick(axes)... });
+		}
+		return points;
+	}
+
+	// Values an asset-liability portfolio under every member of a family of extensions of one base curve,
+	// for assumption studies over ultimate rates, grading periods, windows and start periods. Work that does
+	// not depend on the extension parameters is done once: the base is sampled through a MemoizedCurve, and
+	// flows before an extension's start, where extended curves equal the base, are discounted up front into
+	// running sums. Each grid point then costs building its tail and discounting the flows after its start.
+	// Values under zero-rate shifts of +/- spread come from the same pass, as in RollForward.
+	// Cash flows are read and partly discounted once, by the constructor, so a sweep does not see later
+	// changes to the liabilities or bonds. Its memoized base makes it single-threaded like MemoizedCurve.
+	class ParameterSweep {
+	public:
+		ParameterSweep(
+			const std::shared_ptr<YieldTermStructure>& base,
+			const Leg& liabilities,
+			const std::vector<std::pair<std::shared_ptr<Bond>, Real>>& assets,
+			Spread spread = 0.0001) :
+			spread_(spread), sampled_(std::make_shared<MemoizedCurve>(base)) {
+
+			// Liabilities outstanding after the evaluation date and valued there; bond flows outstanding after
+			// the base's reference date and valued there
+			Date evaluation_date = Settings::instance().evaluationDate();
+			bool include = Settings::instance().includeReferenceDateEvents();
+
+			std::vector<std::pair<Time, Real>> flows;
+			for (const std::shared_ptr<CashFlow>& cf : liabilities) {
+				if (!cf->hasOccurred(evaluation_date, false) && !cf->tradingExCoupon(evaluation_date)) {
+					flows.emplace_back(sampled_->timeFromReference(cf->date()), cf->amount());
+				}
+			}
+			liabilities_ = discountPrefix(flows, sampled_->timeFromReference(evaluation_date));
+
+			flows.clear();
+			Date reference_date = sampled_->referenceDate();
+			for (const auto& [bond, quantity] : assets) {
+				for (const std::shared_ptr<CashFlow>& cf : bond->cashflows()) {
+					if (!cf->hasOccurred(reference_date, include) && !cf->tradingExCoupon(reference_date)) {
+						flows.emplace_back(sampled_->timeFromReference(cf->date()), quantity * cf->amount());
+					}
+				}
+			}
+			assets_ = discountPrefix(flows, 0.0);
+		}
+
+		// Builds method on the shared base and values the portfolio on it
+		template<typename Method>
+		SweepPoint evaluate(const Method& method) const {
+			std::shared_ptr<YieldTermStructure> curve = method.buildCurve(sampled_);
+			Time start = extensionStart(*curve);
+
+			ShiftedValues liabilities = value(liabilities_, *curve, start);
+			ShiftedValues assets = value(assets_, *curve, start);
+
+			SweepPoint point;
+			point.asset_value = assets.value;
+			point.asset_duration = effectiveDuration(assets.value, assets.up, assets.down, spread_);
+			point.asset_convexity = effectiveConvexity(assets.value, assets.up, assets.down, spread_);
+			point.liability_value = liabilities.value;
+			point.liability_duration = effectiveDuration(liabilities.value, liabilities.up, liabilities.down, spread_);
+			point.liability_convexity = effectiveConvexity(liabilities.value, liabilities.up, liabilities.down, spread_);
+			point.surplus = assets.value - liabilities.value;
+			return point;
+		}
+
+		// One point per method, in order
+		template<typename Method>
+		std::vector<SweepPoint> run(const std::vector<Method>& methods) const {
+			std::vector<SweepPoint> points;
+			points.reserve(methods.size());
+			for (const Method& method : methods) {
+				points.push_back(evaluate(method));
+			}
+			return points;
+		}
+
+		// One point per grid entry, each constructing Method from the entry's arguments, e.g.
+		// run<LinearlyGraded<Traits::Forward>>(parameterGrid(ultimate_rates, starts, grading_ends, ends))
+		template<typename Method, typename... Args>
+		std::vector<SweepPoint> run(const std::vector<std::tuple<Args...>>& grid) const {
+			std::vector<SweepPoint> points;
+			points.reserve(grid.size());
+			for (const std::tuple<Args...>& args : grid) {
+				points.push_back(evaluate(std::make_from_tuple<Method>(args)));
+			}
+			return points;
+		}
+
+		// The shared base that extensions are built on
+		std::shared_ptr<YieldTermStructure> base() const {
+			return sampled_;
+		}
+
+	private:
+		// Flows sorted by time, with running sums of their values on the base: entry i sums the flows before i
+		struct Flows {
+			std::vector<Time> times;
+			std::vector<Real> amounts;
+			// exp(-spread * (t - npv_time)), the relative discount under the upward shift
+			std::vector<Real> shifts;
+			std::vector<ShiftedValues> prefix;
+			Time npv_time;
+		};
+
+		Spread spread_;
+		std::shared_ptr<MemoizedCurve> sampled_;
+		Flows liabilities_;
+		Flows assets_;
+
+		Flows discountPrefix(std::vector<std::pair<Time, Real>>& flows, Time npv_time) const {
+			std::stable_sort(flows.begin(), flows.end(),
+				[](const auto& a, const auto& b) { return a.first < b.first; });
+
+			Flows sorted;
+			sorted.npv_time = npv_time;
+			sorted.prefix.push_back({ 0.0, 0.0, 0.0 });
+			for (const auto& [t, amount] : flows) {
+				Real shift = std::exp(-spread_ * (t - npv_time));
+				ShiftedValues running = sorted.prefix.back();
+				addShiftedFlow(running, amount * sampled_->discount(t), shift);
+				sorted.prefix.push_back(running);
+				sorted.times.push_back(t);
+				sorted.amounts.push_back(amount);
+				sorted.shifts.push_back(shift);
+			}
+			return sorted;
+		}
+
+		// Time before which curve equals the base; zero when that is not known
+		static Time extensionStart(const YieldTermStructure& curve) {
+			if (auto hybrid = dynamic_cast<const HybridCurve<Traits::Zero>*>(&curve)) {
+				return hybrid->startTime();
+			}
+			if (auto hybrid = dynamic_cast<const HybridCurve<Traits::Forward>*>(&curve)) {
+				return hybrid->startTime();
+			}
+			return 0.0;
+		}
+
+		static ShiftedValues value(const Flows& flows, const YieldTermStructure& curve, Time start) {
+			Size first_tail = std::lower_bound(flows.times.begin(), flows.times.end(), start) - flows.times.begin();
+			ShiftedValues values = flows.prefix[first_tail];
+			for (Size i = first_tail; i < flows.times.size(); ++i) {
+				addShiftedFlow(values, flows.amounts[i] * curve.discount(flows.times[i]), flows.shifts[i]);
+			}
+
+			// Discounted to the npv date on each curve; the shifts are already relative to it
+			DiscountFactor d0 = curve.discount(flows.npv_time);
+			values.value /= d0;
+			values.up /= d0;
+			values.down /= d0;
+			return values;
+		}
+	};
+
+}
@@ -0,0 +1,136 @@
+#pragma once
+#include "BoundedQueue.h"
+#include "ThreadPool.h"
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+namespace ACHS {
+
+	// Stages connected by bounded queues and run concurrently on a shared thread pool. Each stage runs a fixed
+	// number of worker loops, which hold their pool threads until the stage's input is drained, so the pool
+	// needs at least as many threads as all stages' workers together. The first exception from any stage
+	// cancels every queue and is rethrown by wait().
+	class Pipeline {
+	public:
+		explicit Pipeline(ThreadPool& pool) : pool_(pool) {}
+
+		// A pipeline destroyed before wait(), as when an exception unwinds its owner, cancels every queue so
+		// that blocked workers return, then waits for them before the queues go away
+		~Pipeline() {
+			if (!tasks_.empty()) {
+				std::lock_guard<std::mutex> lock(mutex_);
+				cancel();
+			}
+			for (std::future<void>& task : tasks_) {
+				if (task.valid()) {
+					task.wait();
+				}
+			}
+		}
+
+		// Runs f(item, emit) on every item of in; emit(output) forwards any number of outputs to out,
+		// which is closed once all of this stage's workers have finished
+		template<typename In, typename Out, typename F>
+		void stage(BoundedQueue<In>& in, BoundedQueue<Out>& out, std::size_t workers, F f) {
+			reserve(workers);
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				cancellers_.push_back([&in]() { in.cancel(); });
+				cancellers_.push_back([&out]() { out.cancel(); });
+			}
+
+			auto remaining = std::make_shared<std::atomic<std::size_t>>(workers);
+			for (std::size_t w = 0; w < workers; ++w) {
+				tasks_.push_back(pool_.submit([this, &in, &out, f, remaining]() mutable {
+					try {
+						auto emit = [&out](Out output) { return out.push(std::move(output)); };
+						while (std::optional<In> item = in.pop()) {
+							f(std::move(*item), emit);
+						}
+					}
+					catch (...) {
+						fail(std::current_exception());
+					}
+					if (--*remaining == 0) {
+						out.close();
+					}
+				}));
+			}
+		}
+
+		// Terminal stage running f(item) on every item of in
+		template<typename In, typename F>
+		void sink(BoundedQueue<In>& in, std::size_t workers, F f) {
+			reserve(workers);
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				cancellers_.push_back([&in]() { in.cancel(); });
+			}
+
+			for (std::size_t w = 0; w < workers; ++w) {
+				tasks_.push_back(pool_.submit([this, &in, f]() mutable {
+					try {
+						while (std::optional<In> item = in.pop()) {
+							f(std::move(*item));
+						}
+					}
+					catch (...) {
+						fail(std::current_exception());
+					}
+				}));
+			}
+		}
+
+		// Waits for every stage to finish and rethrows the first failure
+		void wait() {
+			for (std::future<void>& task : tasks_) {
+				task.get();
+			}
+			tasks_.clear();
+			if (error_) {
+				std::rethrow_exception(error_);
+			}
+		}
+
+	private:
+		ThreadPool& pool_;
+		std::vector<std::future<void>> tasks_;
+		std::size_t workers_ = 0;
+
+		// Guards the cancellers, which running workers read on failure, and the first error
+		std::mutex mutex_;
+		std::vector<std::function<void()>> cancellers_;
+		std::exception_ptr error_;
+
+		void reserve(std::size_t workers) {
+			if (workers == 0) {
+				throw std::runtime_error("Pipeline: a stage needs at least one worker.");
+			}
+			workers_ += workers;
+			if (workers_ > pool_.size()) {
+				throw std::runtime_error("Pipeline: thread pool has " + std::to_string(pool_.size())
+					+ " threads but the stages need " + std::to_string(workers_) + ".");
+			}
+		}
+
+		void fail(std::exception_ptr error) {
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (!error_) {
+				error_ = error;
+				cancel();
+			}
+		}
+
+		// Requires mutex_
+		void cancel() {
+			for (auto& canceller : cancellers_) {
+				canceller();
+			}
+		}
+	};
+
+}
@@ -0,0 +1,159 @@
+#pragma once
+#include "ExtensionMethod.h"
+#include "Valuation.h"
+#include <ql/quantlib.hpp>
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+namespace ACHS {
+
+	using namespace QuantLib;
+
+	// Portfolio values at one projection date
+	struct ProjectionStep {
+		Date date;
+		Real asset_value;
+		Real asset_duration;
+		Real asset_convexity;
+		Real liability_value;
+		Real liability_duration;
+		Real liability_convexity;
+		Real surplus;
+		// Flows paid after the previous projection date, up to and including this one
+		Real asset_cash_flow;
+		Real liability_cash_flow;
+	};
+
+	// Rolls an asset-liability portfolio forward without touching the evaluation date or re-bootstrapping.
+	// The base is extended once, at its reference date, and at each date that extended curve is rolled to an
+	// ImpliedTermStructure, so today's forwards are reused on both sides of the extension start. The tail is
+	// not rebuilt: re-extending the rolled base would read the base beyond its last pillar, through a
+	// flat-forward segment, before the new start. Flows dated on or before the valuation date are skipped
+	// by cursors that only move forward, and values under the curve and under zero-rate shifts of
+	// +/- spread come from a single pass over the remaining flows.
+	// Flow amounts are fixed when the projection is constructed.
+	template<typename Method>
+	class RollForward {
+	public:
+		RollForward(
+			const std::shared_ptr<YieldTermStructure>& base,
+			const Method& method,
+			const Leg& liabilities,
+			const std::vector<std::pair<std::shared_ptr<Bond>, Real>>& assets,
+			Spread spread = 0.0001) :
+			base_(base), spread_(spread), date_(base->referenceDate()) {
+
+			base_->enableExtrapolation();
+			extended_ = method.buildCurve(base_);
+			extended_->enableExtrapolation();
+
+			for (const std::shared_ptr<CashFlow>& cf : liabilities) {
+				liability_flows_.push_back({ cf->date(), cf->amount() });
+			}
+			for (const auto& [bond, quantity] : assets) {
+				for (const std::shared_ptr<CashFlow>& cf : bond->cashflows()) {
+					asset_flows_.push_back({ cf->date(), quantity * cf->amount() });
+				}
+			}
+
+			auto by_date = [](const Flow& a, const Flow& b) { return a.date < b.date; };
+			std::stable_sort(liability_flows_.begin(), liability_flows_.end(), by_date);
+			std::stable_sort(asset_flows_.begin(), asset_flows_.end(), by_date);
+
+			// Flows already paid at the reference date are not part of the projection
+			liability_cursor_ = skip(liability_flows_, 0, date_).first;
+			asset_cursor_ = skip(asset_flows_, 0, date_).first;
+		}
+
+		// Moves the valuation date forward to date and values the portfolio there
+		ProjectionStep advance(const Date& date) {
+			if (date < date_) {
+				throw std::runtime_error("RollForward::advance: projection dates must not decrease.");
+			}
+
+			auto [liability_cursor, liability_cash_flow] = skip(liability_flows_, liability_cursor_, date);
+			auto [asset_cursor, asset_cash_flow] = skip(asset_flows_, asset_cursor_, date);
+			liability_cursor_ = liability_cursor;
+			asset_cursor_ = asset_cursor;
+			date_ = date;
+
+			curve_ = std::make_shared<ImpliedTermStructure>(Handle<YieldTermStructure>(extended_), date);
+			curve_->enableExtrapolation();
+
+			ShiftedValues liabilities = value(liability_flows_, liability_cursor_);
+			ShiftedValues assets = value(asset_flows_, asset_cursor_);
+
+			ProjectionStep step;
+			step.date = date;
+			step.asset_value = assets.value;
+			step.asset_duration = effectiveDuration(assets.value, assets.up, assets.down, spread_);
+			step.asset_convexity = effectiveConvexity(assets.value, assets.up, assets.down, spread_);
+			step.liability_value = liabilities.value;
+			step.liability_duration = effectiveDuration(liabilities.value, liabilities.up, liabilities.down, spread_);
+			step.liability_convexity = effectiveConvexity(liabilities.value, liabilities.up, liabilities.down, spread_);
+			step.surplus = assets.value - liabilities.value;
+			step.asset_cash_flow = asset_cash_flow;
+			step.liability_cash_flow = liability_cash_flow;
+			return step;
+		}
+
+		// Projects at the reference date and every step thereafter up to reference date + horizon
+		std::vector<ProjectionStep> project(const Period& horizon, const Period& step = Period(1, Months)) {
+			Date reference_date = base_->referenceDate();
+			Date end_date = reference_date + horizon;
+
+			std::vector<ProjectionStep> steps;
+			for (Integer n = 0; reference_date + n * step <= end_date; ++n) {
+				steps.push_back(advance(reference_date + n * step));
+			}
+			return steps;
+		}
+
+		const Date& date() const {
+			return date_;
+		}
+
+		// Extended curve rolled to the current projection date
+		std::shared_ptr<YieldTermStructure> curve() const {
+			return curve_;
+		}
+
+	private:
+		struct Flow {
+			Date date;
+			Real amount;
+		};
+
+		std::shared_ptr<YieldTermStructure> base_;
+		std::shared_ptr<YieldTermStructure> extended_;
+		Spread spread_;
+
+		Date date_;
+		std::shared_ptr<YieldTermStructure> curve_;
+
+		std::vector<Flow> liability_flows_;
+		std::vector<Flow> asset_flows_;
+		Size liability_cursor_ = 0;
+		Size asset_cursor_ = 0;
+
+		// Moves a cursor past the flows dated on or before date; returns the new cursor and the amount passed
+		static std::pair<Size, Real> skip(const std::vector<Flow>& flows, Size cursor, const Date& date) {
+			Real paid = 0.0;
+			while (cursor < flows.size() && flows[cursor].date <= date) {
+				paid += flows[cursor++].amount;
+			}
+			return { cursor, paid };
+		}
+
+		ShiftedValues value(const std::vector<Flow>& flows, Size cursor) const {
+			ShiftedValues values{ 0.0, 0.0, 0.0 };
+			for (Size i = cursor; i < flows.size(); ++i) {
+				Time t = curve_->timeFromReference(flows[i].date);
+				addShiftedFlow(values, flows[i].amount * curve_->discount(t), std::exp(-spread_ * t));
+			}
+			return values;
+		}
+	};
+
+}
@@ -1,5 +1,6 @@
 #pragma once
 #include "ExtensionMethod.h"
+#include "HybridCurve.h"
 #include <ql/quantlib.hpp>
 #include <algorithm>
 #include <vector>
@@ -8,6 +9,8 @@ namespace ACHS {
 
 	using namespace QuantLib;
 
+	// Continues the base curve on a grid of step from the start period to the end period, each tail rate
+	// being the average of the window_size rates before it: base rates at first, then earlier tail rates.
 	template<typename Trait>
 	class RollingAverage : public ExtensionMethod<RollingAverage<Trait>, Trait> {
 		friend class ExtensionMethod<RollingAverage<Trait>, Trait>;
@@ -17,60 +20,108 @@ namespace ACHS {
 			const Period& start_period,
 			const Period& end_period,
 			const Period& step = Period(1, Months)) : 
-			window_size_(window_size),
-			ExtensionMethod<RollingAverage<Trait>, Trait>(start_period, end_period, step) { }
+			ExtensionMethod<RollingAverage<Trait>, Trait>(start_period, end_period, step),
+			window_size_(window_size) { }
 
 	protected:
 		std::shared_ptr<YieldTermStructure> buildCurveImpl(
 			const std::shared_ptr<YieldTermStructure>& base) const {
 
+			return std::make_shared<HybridCurve<Trait>>(
+				base,
+				base->referenceDate() + this->end_period_,
+				[method = *this](const std::shared_ptr<YieldTermStructure>& b) { return method.tail(b); });
+		}
+
+		typename HybridCurve<Trait>::Tail tail(
+			const std::shared_ptr<YieldTermStructure>& base) const {
+
 			DayCounter day_counter = base->dayCounter();
 			Date reference_date = base->referenceDate();
 
 			Date start_date = reference_date + this->start_period_;
 			Date end_date = reference_date + this->end_period_;
 
-			std::vector<Date> dates;
-			std::vector<Rate> rates;
+			std::vector<Date> grid;
+			for (Date d = reference_date; d <= end_date; d += this->step_) {
+				grid.push_back(d);
+			}
 
+			std::size_t first_tail = std::lower_bound(grid.begin(), grid.end(), start_date) - grid.begin();
+			if (first_tail == grid.size()) {
+				throw std::runtime_error("RollingAverage::tail: start period beyond end period.");
+			}
+
+			// Only the window of base rates immediately before the start needs to be sampled
 			std::deque<Rate> trailing_window;
+			for (std::size_t i = first_tail - std::min<std::size_t>(first_tail, window_size_); i < first_tail; ++i) {
+				trailing_window.push_back(extractRate<Trait>(base, day_counter.yearFraction(reference_date, grid[i])));
+			}
 
-			for (Date d = reference_date; d <= end_date; d += this->step_) {
-				Time t = day_counter.yearFraction(reference_date, d);
-				Rate r;
+			std::vector<Time> times;
+			std::vector<Rate> rates;
 
-				if (d < start_date) {
-					r = extractRate<Trait>(base, t);
-				}
-				else {
-					// Use rolling average of prior window_size_ rates
-					if (trailing_window.size() < window_size_) {
-						r = trailing_window.empty()
-							? extractRate<Trait>(base, t)
-							: std::accumulate(trailing_window.begin(), trailing_window.end(), 0.0) / trailing_window.size();
-					}
-					else {
-						r = std::accumulate(trailing_window.begin(), trailing_window.end(), 0.0) / window_size_;
-					}
-				}
+			for (std::size_t i = first_tail; i < grid.size(); ++i) {
+				Time t = day_counter.yearFraction(reference_date, grid[i]);
+
+				// Use rolling average of prior window_size_ rates
+				Rate r = trailing_window.empty()
+					? extractRate<Trait>(base, t)
+					: std::accumulate(trailing_window.begin(), trailing_window.end(), 0.0) / trailing_window.size();
 
 				// Append to rolling window
 				trailing_window.push_back(r);
 				if (trailing_window.size() > window_size_)
 					trailing_window.pop_front();
 
-				dates.push_back(d);
+				times.push_back(t);
 				rates.push_back(r);
 			}
 
-			if constexpr (std::is_same_v<Trait, Traits::Zero>) {
-				return std::make_shared<ZeroCurve>(dates, rates, day_counter);
+			return { times, rates };
+		}
+
+		void adjointImpl(
+			const std::shared_ptr<YieldTermStructure>& base,
+			const YieldTermStructure& curve,
+			const DiscountAdjoint& curve_adjoint,
+			DiscountAdjoint& base_adjoint) const {
+
+			const auto& hybrid = dynamic_cast<const HybridCurve<Trait>&>(curve);
+			std::vector<Real> rate_adjoints = hybrid.adjoint(curve_adjoint, base_adjoint);
+			const std::vector<Time>& tail_times = hybrid.tailTimes();
+
+			DayCounter day_counter = base->dayCounter();
+			Date reference_date = base->referenceDate();
+			Date start_date = reference_date + this->start_period_;
+
+			std::vector<Time> sample_times;
+			Size first_tail = 0;
+			for (Date d = reference_date; d < start_date; d += this->step_) {
+				sample_times.push_back(day_counter.yearFraction(reference_date, d));
+				++first_tail;
 			}
-			else if constexpr (std::is_same_v<Trait, Traits::Forward>) {
-				return std::make_shared<ForwardCurve>(dates, rates, day_counter);
+			sample_times.erase(sample_times.begin(), sample_times.end() - std::min<Size>(first_tail, window_size_));
+
+			// Values in the order they enter the window: base samples, then tail nodes. Node k averages the
+			// min(window_size_, samples + k) values before it, or samples the base when that window is empty.
+			Size samples = sample_times.size();
+			std::vector<Real> adjoints(samples, 0.0);
+			adjoints.insert(adjoints.end(), rate_adjoints.begin(), rate_adjoints.end());
+
+			for (Size k = tail_times.size(); k-- > 0;) {
+				Size length = std::min<Size>(window_size_, samples + k);
+				if (length == 0) {
+					extractRateAdjoint<Trait>(base, tail_times[k], adjoints[samples + k], base_adjoint);
+					continue;
+				}
+				for (Size s = samples + k - length; s < samples + k; ++s) {
+					adjoints[s] += adjoints[samples + k] / length;
+				}
 			}
-			else {
-				throw std::runtime_error("RollingAverage::buildCurveImpl: unknown trait.");
+
+			for (Size i = 0; i < samples; ++i) {
+				extractRateAdjoint<Trait>(base, sample_times[i], adjoints[i], base_adjoint);
 			}
 		}
 
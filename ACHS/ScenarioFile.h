@@ -0,0 +1,540 @@
+#pragma once
+#include "ExtensionMethod.h"
+#include "ExtendedCurves.h"
+#include <ql/quantlib.hpp>
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ACHS {
+
+	using namespace QuantLib;
+
+	// Economic scenario files: one rate path per scenario on a common grid of times in years, with rates
+	// annually compounded zero (Traits::Zero) or instantaneous forward (Traits::Forward) rates, as returned
+	// by extractRate.
+	//
+	// CSV:    a header "ScenarioId,<t_1>,...,<t_n>", then one row "<id>,<r_1>,...,<r_n>" per scenario.
+	// Binary: a ScenarioFiles::Header, the n times, the scenario ids as int64, then the rates as doubles,
+	//         scenario-major. Binary rates are used in place; CSV rows are parsed one chunk at a time.
+	namespace ScenarioFiles {
+
+		constexpr std::uint64_t magic = 0x3147534553484341; // "ACHSESG1" in little-endian byte order
+
+		struct Header {
+			std::uint64_t magic;
+			std::uint32_t kind;          // 0 zero rates, 1 forward rates
+			std::uint32_t reserved;
+			std::uint64_t scenario_count;
+			std::uint64_t point_count;
+		};
+
+		template<typename Trait>
+		constexpr std::uint32_t kind() {
+			if constexpr (std::is_same_v<Trait, Traits::Zero>) {
+				return 0;
+			}
+			else {
+				static_assert(std::is_same_v<Trait, Traits::Forward>, "ScenarioFiles::kind: unknown trait.");
+				return 1;
+			}
+		}
+
+		// Read-only view of a byte range of a file, unmapped on destruction
+		class MappedRegion {
+		public:
+			MappedRegion(void* view, std::size_t view_size, std::size_t skip) :
+				view_(view), view_size_(view_size), data_(static_cast<const char*>(view) + skip), size_(view_size - skip) {}
+
+			~MappedRegion() {
+#if defined(_WIN32)
+				UnmapViewOfFile(view_);
+#else
+				munmap(view_, view_size_);
+#endif
+			}
+
+			MappedRegion(const MappedRegion&) = delete;
+			MappedRegion& operator=(const MappedRegion&) = delete;
+
+			const char* data() const { return data_; }
+			std::size_t size() const { return size_; }
+
+		private:
+			void* view_;
+			std::size_t view_size_;
+			const char* data_;
+			std::size_t size_;
+		};
+
+		// Read-only file that maps byte ranges on demand, so only the ranges in use are resident
+		class MappedFile {
+		public:
+			explicit MappedFile(const std::string& filename) {
+#if defined(_WIN32)
+				file_ = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+				if (file_ == INVALID_HANDLE_VALUE) {
+					throw std::runtime_error("MappedFile: failed to open file: " + filename + ".");
+				}
+				LARGE_INTEGER size;
+				GetFileSizeEx(file_, &size);
+				size_ = static_cast<std::uint64_t>(size.QuadPart);
+				if (size_ > 0) {
+					mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+					if (!mapping_) {
+						CloseHandle(file_);
+						throw std::runtime_error("MappedFile: failed to map file: " + filename + ".");
+					}
+				}
+				SYSTEM_INFO info;
+				GetSystemInfo(&info);
+				granularity_ = info.dwAllocationGranularity;
+#else
+				fd_ = open(filename.c_str(), O_RDONLY);
+				if (fd_ < 0) {
+					throw std::runtime_error("MappedFile: failed to open file: " + filename + ".");
+				}
+				struct stat st;
+				if (fstat(fd_, &st) != 0) {
+					close(fd_);
+					throw std::runtime_error("MappedFile: failed to stat file: " + filename + ".");
+				}
+				size_ = static_cast<std::uint64_t>(st.st_size);
+				granularity_ = static_cast<std::uint64_t>(sysconf(_SC_PAGESIZE));
+#endif
+				filename_ = filename;
+			}
+
+			~MappedFile() {
+#if defined(_WIN32)
+				if (mapping_) {
+					CloseHandle(mapping_);
+				}
+				CloseHandle(file_);
+#else
+				close(fd_);
+#endif
+			}
+
+			MappedFile(const MappedFile&) = delete;
+			MappedFile& operator=(const MappedFile&) = delete;
+
+			std::uint64_t size() const {
+				return size_;
+			}
+
+			// Maps [offset, offset + length); the view starts at the preceding mapping boundary
+			std::shared_ptr<const MappedRegion> map(std::uint64_t offset, std::uint64_t length) const {
+				if (offset + length > size_ || length == 0) {
+					throw std::runtime_error("MappedFile::map: range outside file: " + filename_ + ".");
+				}
+				std::uint64_t aligned = offset - offset % granularity_;
+				std::size_t skip = static_cast<std::size_t>(offset - aligned);
+				std::size_t view_size = static_cast<std::size_t>(length) + skip;
+#if defined(_WIN32)
+				void* view = MapViewOfFile(mapping_, FILE_MAP_READ,
+					static_cast<DWORD>(aligned >> 32), static_cast<DWORD>(aligned & 0xFFFFFFFF), view_size);
+				if (!view) {
+					throw std::runtime_error("MappedFile::map: failed to map view of file: " + filename_ + ".");
+				}
+#else
+				void* view = mmap(nullptr, view_size, PROT_READ, MAP_PRIVATE, fd_, static_cast<off_t>(aligned));
+				if (view == MAP_FAILED) {
+					throw std::runtime_error("MappedFile::map: failed to map file: " + filename_ + ".");
+				}
+				madvise(view, view_size, MADV_SEQUENTIAL);
+#endif
+				return std::make_shared<const MappedRegion>(view, view_size, skip);
+			}
+
+		private:
+			std::string filename_;
+			std::uint64_t size_ = 0;
+			std::uint64_t granularity_ = 4096;
+#if defined(_WIN32)
+			HANDLE file_ = INVALID_HANDLE_VALUE;
+			HANDLE mapping_ = nullptr;
+#else
+			int fd_ = -1;
+#endif
+		};
+
+		// Parses the comma-separated numbers in [begin, end), after skipping skip_fields fields; the row must
+		// hold exactly count numbers
+		inline void parseRow(const char* begin, const char* end, Size skip_fields, double* out, Size count, const std::string& context) {
+			const char* p = begin;
+			for (Size f = 0; f < skip_fields; ++f) {
+				p = std::find(p, end, ',');
+				if (p == end) {
+					throw std::runtime_error("ScenarioFile: missing values in " + context + ".");
+				}
+				++p;
+			}
+			for (Size i = 0; i < count; ++i) {
+				while (p < end && (*p == ' ' || *p == '\t')) {
+					++p;
+				}
+				auto [next, error] = std::from_chars(p, end, out[i]);
+				if (error != std::errc()) {
+					throw std::runtime_error("ScenarioFile: invalid value in " + context + ".");
+				}
+				p = next;
+				while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) {
+					++p;
+				}
+				if (i + 1 < count) {
+					if (p == end || *p != ',') {
+						throw std::runtime_error("ScenarioFile: missing values in " + context + ".");
+					}
+					++p;
+				}
+			}
+			if (p != end) {
+				throw std::runtime_error("ScenarioFile: extra values in " + context + ".");
+			}
+		}
+
+	}
+
+	// Zero-copy curve over one scenario's rates, interpolated linearly on log(1 + r) like HybridCurve and
+	// held flat outside the grid. Forward-rate integrals are accumulated on first use.
+	template<typename Trait>
+	class ScenarioCurve : public YieldTermStructure {
+	public:
+		ScenarioCurve(
+			const Date& reference_date,
+			const DayCounter& day_counter,
+			const Date& max_date,
+			const double* times,
+			const double* rates,
+			Size points,
+			std::shared_ptr<const void> holder) :
+			YieldTermStructure(reference_date, Calendar(), day_counter),
+			max_date_(max_date), times_(times), rates_(rates), points_(points), holder_(std::move(holder)) {}
+
+		Date maxDate() const override {
+			return max_date_;
+		}
+
+	protected:
+		DiscountFactor discountImpl(Time t) const override {
+			std::size_t k = 0;
+			Real w = 0.0;
+			if (t >= times_[points_ - 1]) {
+				k = points_ - 1;
+			}
+			else if (t > times_[0]) {
+				k = std::upper_bound(times_, times_ + points_, t) - times_ - 1;
+				w = (t - times_[k]) / (times_[k + 1] - times_[k]);
+			}
+
+			Rate r_k = std::log(1.0 + rates_[k]);
+			Rate r = (w > 0.0) ? r_k * (1.0 - w) + std::log(1.0 + rates_[k + 1]) * w : r_k;
+
+			if constexpr (std::is_same_v<Trait, Traits::Zero>) {
+				return std::exp(-r * t);
+			}
+			else if constexpr (std::is_same_v<Trait, Traits::Forward>) {
+				if (t <= times_[0]) {
+					return std::exp(-r * t);
+				}
+				std::call_once(cumulative_once_, [this]() { accumulate(); });
+				return std::exp(-(cumulative_[k] + 0.5 * (r_k + r) * (t - times_[k])));
+			}
+			else {
+				throw std::runtime_error("ScenarioCurve::discountImpl: unknown trait.");
+			}
+		}
+
+	private:
+		Date max_date_;
+		const double* times_;
+		const double* rates_;
+		Size points_;
+		std::shared_ptr<const void> holder_;
+
+		mutable std::once_flag cumulative_once_;
+		mutable std::vector<Real> cumulative_;
+
+		// Integrated forward from zero to each grid time, flat before the first
+		void accumulate() const {
+			cumulative_.resize(points_);
+			Rate previous = std::log(1.0 + rates_[0]);
+			cumulative_[0] = previous * times_[0];
+			for (Size k = 1; k < points_; ++k) {
+				Rate current = std::log(1.0 + rates_[k]);
+				cumulative_[k] = cumulative_[k - 1] + 0.5 * (previous + current) * (times_[k] - times_[k - 1]);
+				previous = current;
+			}
+		}
+	};
+
+	// Scenarios [first, first + size) of a ScenarioFile. Curves keep the chunk's mapping or parsed rates alive.
+	template<typename Trait>
+	class ScenarioChunk {
+	public:
+		ScenarioChunk(
+			Size first,
+			std::vector<std::string> ids,
+			const double* rates,
+			std::shared_ptr<const void> holder,
+			std::shared_ptr<const std::vector<double>> times,
+			const Date& reference_date,
+			const DayCounter& day_counter,
+			const Date& max_date) :
+			first_(first), ids_(std::move(ids)), rates_(rates), holder_(std::move(holder)), times_(std::move(times)),
+			reference_date_(reference_date), day_counter_(day_counter), max_date_(max_date) {}
+
+		Size first() const {
+			return first_;
+		}
+
+		Size size() const {
+			return ids_.size();
+		}
+
+		const std::string& id(Size i) const {
+			return ids_.at(i);
+		}
+
+		// Rates of the chunk's scenarios, scenario-major
+		const double* rates() const {
+			return rates_;
+		}
+
+		std::shared_ptr<YieldTermStructure> curve(Size i) const {
+			if (i >= ids_.size()) {
+				throw std::runtime_error("ScenarioChunk::curve: index " + std::to_string(i) + " outside chunk.");
+			}
+			Size points = times_->size();
+			auto holder = std::make_shared<std::pair<std::shared_ptr<const void>, std::shared_ptr<const std::vector<double>>>>(holder_, times_);
+			return std::make_shared<ScenarioCurve<Trait>>(
+				reference_date_, day_counter_, max_date_, times_->data(), rates_ + i * points, points, holder);
+		}
+
+		// Adds every scenario's curve to curves as name in the scenario named by its id, where
+		// setActiveCurve(name, id) finds it. Use an ExtendedCurves per chunk to keep only one chunk resident.
+		void addTo(ExtendedCurves& curves, const std::string& name) const {
+			for (Size i = 0; i < size(); ++i) {
+				curves.addOrUpdate(name, std::make_shared<ExtendedCurveWrapper>(curve(i)), ids_[i]);
+			}
+		}
+
+	private:
+		Size first_;
+		std::vector<std::string> ids_;
+		const double* rates_;
+		std::shared_ptr<const void> holder_;
+		std::shared_ptr<const std::vector<double>> times_;
+		Date reference_date_;
+		DayCounter day_counter_;
+		Date max_date_;
+	};
+
+	// Memory-mapped economic scenario file in either layout, detected from the leading bytes. Opening reads
+	// only the header (and, for CSV, one pass to index row offsets); scenarios are mapped chunk by chunk, so
+	// the whole file never needs to be resident.
+	template<typename Trait>
+	class ScenarioFile {
+	public:
+		ScenarioFile(const std::string& filename, const Date& reference_date, const DayCounter& day_counter) :
+			file_(std::make_shared<ScenarioFiles::MappedFile>(filename)), filename_(filename),
+			reference_date_(reference_date), day_counter_(day_counter) {
+
+			if (file_->size() >= sizeof(ScenarioFiles::Header)) {
+				auto region = file_->map(0, sizeof(ScenarioFiles::Header));
+				ScenarioFiles::Header header;
+				std::memcpy(&header, region->data(), sizeof(header));
+				binary_ = header.magic == ScenarioFiles::magic;
+				if (binary_) {
+					openBinary(header);
+				}
+			}
+			if (!binary_) {
+				openCsv();
+			}
+
+			if (times_->empty()) {
+				throw std::runtime_error("ScenarioFile: no rate points in " + filename_ + ".");
+			}
+			// First date at or beyond the last grid time
+			max_date_ = reference_date_ + static_cast<Date::serial_type>(std::ceil(times_->back() * 366.0));
+		}
+
+		bool binary() const {
+			return binary_;
+		}
+
+		Size size() const {
+			return scenarios_;
+		}
+
+		const std::vector<double>& times() const {
+			return *times_;
+		}
+
+		ScenarioChunk<Trait> chunk(Size first, Size count) const {
+			if (first >= scenarios_ || count == 0) {
+				throw std::runtime_error("ScenarioFile::chunk: no scenarios from " + std::to_string(first) + " in " + filename_ + ".");
+			}
+			count = std::min(count, scenarios_ - first);
+			Size points = times_->size();
+
+			if (binary_) {
+				auto ids_region = file_->map(ids_offset_ + first * sizeof(std::int64_t), count * sizeof(std::int64_t));
+				std::vector<std::string> ids;
+				for (Size i = 0; i < count; ++i) {
+					std::int64_t id;
+					std::memcpy(&id, ids_region->data() + i * sizeof(std::int64_t), sizeof(id));
+					ids.push_back(std::to_string(id));
+				}
+
+				auto region = file_->map(rates_offset_ + first * points * sizeof(double), count * points * sizeof(double));
+				const double* rates = reinterpret_cast<const double*>(region->data());
+				return ScenarioChunk<Trait>(first, std::move(ids), rates, region, times_, reference_date_, day_counter_, max_date_);
+			}
+
+			std::uint64_t begin = row_offsets_[first];
+			std::uint64_t end = row_offsets_[first + count];
+			auto region = file_->map(begin, end - begin);
+			auto rates = std::make_shared<std::vector<double>>(count * points);
+			std::vector<std::string> ids;
+
+			const char* p = region->data();
+			for (Size i = 0; i < count; ++i) {
+				const char* row_end = region->data() + (row_offsets_[first + i + 1] - begin);
+				const char* comma = std::find(p, row_end, ',');
+				ids.emplace_back(p, comma);
+				ScenarioFiles::parseRow(p, row_end, 1, rates->data() + i * points, points,
+					"scenario row " + std::to_string(first + i + 1) + " of " + filename_);
+				p = row_end;
+			}
+			return ScenarioChunk<Trait>(first, std::move(ids), rates->data(), rates, times_, reference_date_, day_counter_, max_date_);
+		}
+
+		// Calls f(chunk) for consecutive chunks of up to chunk_size scenarios; each chunk is released
+		// before the next is mapped unless f keeps its curves
+		template<typename F>
+		void forEachChunk(Size chunk_size, F f) const {
+			for (Size first = 0; first < scenarios_; first += chunk_size) {
+				f(chunk(first, chunk_size));
+			}
+		}
+
+		// Writes the scenarios in the binary layout, chunk by chunk; CSV ids must be integers
+		void writeBinary(const std::string& filename, Size chunk_size = 1024) const {
+			std::ofstream out(filename, std::ios::binary);
+			if (!out.is_open()) {
+				throw std::runtime_error("ScenarioFile::writeBinary: failed to open file: " + filename + ".");
+			}
+
+			ScenarioFiles::Header header{ ScenarioFiles::magic, ScenarioFiles::kind<Trait>(), 0, scenarios_, times_->size() };
+			out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			out.write(reinterpret_cast<const char*>(times_->data()), times_->size() * sizeof(double));
+
+			forEachChunk(chunk_size, [&](const ScenarioChunk<Trait>& chunk) {
+				for (Size i = 0; i < chunk.size(); ++i) {
+					std::int64_t id = std::stoll(chunk.id(i));
+					out.write(reinterpret_cast<const char*>(&id), sizeof(id));
+				}
+			});
+			forEachChunk(chunk_size, [&](const ScenarioChunk<Trait>& chunk) {
+				out.write(reinterpret_cast<const char*>(chunk.rates()), chunk.size() * times_->size() * sizeof(double));
+			});
+		}
+
+	private:
+		std::shared_ptr<ScenarioFiles::MappedFile> file_;
+		std::string filename_;
+		Date reference_date_;
+		DayCounter day_counter_;
+		Date max_date_;
+
+		bool binary_ = false;
+		Size scenarios_ = 0;
+		std::shared_ptr<const std::vector<double>> times_;
+
+		std::uint64_t ids_offset_ = 0;
+		std::uint64_t rates_offset_ = 0;
+		std::vector<std::uint64_t> row_offsets_;
+
+		void openBinary(const ScenarioFiles::Header& header) {
+			if (header.kind != ScenarioFiles::kind<Trait>()) {
+				throw std::runtime_error("ScenarioFile: rate kind of " + filename_ + " does not match the requested trait.");
+			}
+			scenarios_ = static_cast<Size>(header.scenario_count);
+			Size points = static_cast<Size>(header.point_count);
+
+			std::uint64_t times_offset = sizeof(ScenarioFiles::Header);
+			ids_offset_ = times_offset + points * sizeof(double);
+			rates_offset_ = ids_offset_ + scenarios_ * sizeof(std::int64_t);
+			if (points == 0 || rates_offset_ + static_cast<std::uint64_t>(scenarios_) * points * sizeof(double) != file_->size()) {
+				throw std::runtime_error("ScenarioFile: size of " + filename_ + " does not match its header.");
+			}
+
+			auto region = file_->map(times_offset, points * sizeof(double));
+			auto times = std::make_shared<std::vector<double>>(points);
+			std::memcpy(times->data(), region->data(), points * sizeof(double));
+			times_ = times;
+		}
+
+		// Indexes row starts in one sequential pass over windows of the file
+		void openCsv() {
+			const std::uint64_t window = std::uint64_t(64) << 20;
+			std::uint64_t size = file_->size();
+
+			std::string header;
+			bool in_header = true;
+			for (std::uint64_t offset = 0; offset < size; offset += window) {
+				std::uint64_t length = std::min(window, size - offset);
+				auto region = file_->map(offset, length);
+				const char* data = region->data();
+				for (const char* p = data; p < data + length; ) {
+					const char* newline = static_cast<const char*>(std::memchr(p, '\n', data + length - p));
+					if (in_header) {
+						header.append(p, newline ? newline : data + length);
+					}
+					if (!newline) {
+						break;
+					}
+					in_header = false;
+					row_offsets_.push_back(offset + (newline - data) + 1);
+					p = newline + 1;
+				}
+			}
+
+			// Row i spans [row_offsets_[i], row_offsets_[i + 1]); blank trailing lines are dropped
+			if (row_offsets_.empty() || row_offsets_.back() != size) {
+				row_offsets_.push_back(size);
+			}
+			while (row_offsets_.size() > 1 && row_offsets_[row_offsets_.size() - 1] - row_offsets_[row_offsets_.size() - 2] <= 2) {
+				row_offsets_.pop_back();
+			}
+			scenarios_ = row_offsets_.size() - 1;
+
+			Size points = static_cast<Size>(std::count(header.begin(), header.end(), ','));
+			auto times = std::make_shared<std::vector<double>>(points);
+			ScenarioFiles::parseRow(header.data(), header.data() + header.size(), 1, times->data(), points, "header of " + filename_);
+			times_ = times;
+		}
+	};
+
+}
@@ -0,0 +1,270 @@
+#pragma once
+#include "DiscountAdjoint.h"
+#include "ExtendedCurve.h"
+#include "Valuation.h"
+#include <ql/quantlib.hpp>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+namespace ACHS {
+
+	using namespace QuantLib;
+
+	// Sensitivities of curve-based outputs to market quotes. Valuation and extension are swept in reverse
+	// once per output, leaving its adjoint with respect to the base curve's discount factors, which
+	// calculate() carries back to the quotes. Piecewise bases registered with addCalibration are
+	// differentiated through their bootstrap by the implicit-function theorem: the bootstrap makes every
+	// helper's implied quote equal its market quote, so the nodes move with the quotes by the inverse of the
+	// Jacobian of the implied quotes to the nodes, built once per base from perturbed copies of the
+	// calibrated nodes without bootstrapping again. Other bases, such as fitted curves, fall back to bumping
+	// each quote up and down and re-reading the base, two re-fits per quote and base; these bases must
+	// observe the quotes and must not be frozen, and calculate() throws otherwise.
+	class QuoteSensitivities {
+	public:
+		// Quotes are bumped by relative_bump * max(|quote|, 1)
+		QuoteSensitivities(std::vector<std::shared_ptr<SimpleQuote>> quotes, Real relative_bump = 1.0e-4) :
+			quotes_(std::move(quotes)), relative_bump_(relative_bump) {}
+
+		// Registers an output by its adjoint with respect to base's discount factors
+		Size add(const std::shared_ptr<YieldTermStructure>& base, const DiscountAdjoint& base_adjoint) {
+			outputs_.push_back({ base, base_adjoint });
+			deltas_.clear();
+			return outputs_.size() - 1;
+		}
+
+		// Registers the helpers a piecewise base was bootstrapped from, so that its deltas come from the
+		// calibration. They must be built on the same quotes as the base's own helpers but must not be those,
+		// since calculate() points them at perturbed copies of the base.
+		template<typename Traits, typename Interpolator>
+		void addCalibration(
+			const std::shared_ptr<PiecewiseYieldCurve<Traits, Interpolator>>& base,
+			std::vector<std::shared_ptr<RateHelper>> helpers)
+		{
+			Size nodes = base->dates().size() - 1;
+			if (helpers.size() != nodes) {
+				throw std::runtime_error("QuoteSensitivities::addCalibration: " + std::to_string(helpers.size())
+					+ " helpers for " + std::to_string(nodes) + " bootstrapped nodes.");
+			}
+
+			// Helpers on quotes outside quotes_ hold their quotes fixed
+			Calibration calibration;
+			calibration.base = base;
+			for (const auto& helper : helpers) {
+				const Quote* quote = helper->quote().currentLink().get();
+				auto it = std::find_if(quotes_.begin(), quotes_.end(), [quote](const std::shared_ptr<SimpleQuote>& q) {
+					return q.get() == quote;
+				});
+				calibration.quotes.push_back(static_cast<Size>(it - quotes_.begin()));
+			}
+
+			// Central differences in each node, with the node at the reference date following the first
+			// node as it does in the bootstrap
+			calibration.differentiate = [base, helpers](const std::vector<Time>& times, Matrix& quote_jacobian, Matrix& discount_jacobian) {
+				using Curve = typename Traits::template curve<Interpolator>::type;
+				const std::vector<Date>& dates = base->dates();
+				const std::vector<Real>& data = base->data();
+				Size n = helpers.size();
+
+				quote_jacobian = Matrix(n, n);
+				discount_jacobian = Matrix(times.size(), n);
+				for (Size k = 1; k <= n; ++k) {
+					Real h = 1.0e-6 * std::max(std::abs(data[k]), 1.0);
+					std::vector<Real> up = data;
+					std::vector<Real> down = data;
+					Traits::updateGuess(up, data[k] + h, k);
+					Traits::updateGuess(down, data[k] - h, k);
+					Curve curve_up(dates, up, base->dayCounter());
+					Curve curve_down(dates, down, base->dayCounter());
+
+					for (Size i = 0; i < n; ++i) {
+						helpers[i]->setTermStructure(&curve_up);
+						Real implied_up = helpers[i]->impliedQuote();
+						helpers[i]->setTermStructure(&curve_down);
+						Real implied_down = helpers[i]->impliedQuote();
+						quote_jacobian[i][k - 1] = (implied_up - implied_down) / (2.0 * h);
+					}
+					for (Size r = 0; r < times.size(); ++r) {
+						discount_jacobian[r][k - 1] = (curve_up.discount(times[r], true) - curve_down.discount(times[r], true)) / (2.0 * h);
+					}
+				}
+			};
+
+			calibrations_[base.get()] = std::move(calibration);
+			deltas_.clear();
+		}
+
+		// Registers the value of a leg or bond on an extended curve
+		template<typename Instrument>
+		Size addValue(const ExtendedCurveWrapper& wrapper, const Instrument& instrument) {
+			if (!wrapper.base()) {
+				throw std::runtime_error("QuoteSensitivities::addValue: curve was not built by an extension method.");
+			}
+			DiscountAdjoint curve_adjoint;
+			discountedValueAdjoint(instrument, *wrapper.curve(), 1.0, curve_adjoint);
+
+			DiscountAdjoint base_adjoint;
+			wrapper.adjoint(curve_adjoint, base_adjoint);
+			return add(wrapper.base(), base_adjoint);
+		}
+
+		void calculate() {
+			// Distinct bases and the union of the times read from each
+			std::map<YieldTermStructure*, std::vector<Time>> probes;
+			for (const Output& output : outputs_) {
+				std::vector<Time>& times = probes[output.base.get()];
+				for (const auto& [t, adjoint] : output.base_adjoint) {
+					times.push_back(t);
+				}
+			}
+			for (auto& [base, times] : probes) {
+				std::sort(times.begin(), times.end());
+				times.erase(std::unique(times.begin(), times.end()), times.end());
+			}
+
+			deltas_.assign(outputs_.size(), std::vector<Real>(quotes_.size(), 0.0));
+
+			// Calibrated bases: d(nodes) / d(quotes) is the inverse of the implied quotes' Jacobian, so each
+			// output's deltas are its node adjoint times that inverse
+			for (const auto& [base, calibration] : calibrations_) {
+				auto probe = probes.find(base);
+				if (probe == probes.end()) {
+					continue;
+				}
+				const std::vector<Time>& times = probe->second;
+
+				Matrix quote_jacobian;
+				Matrix discount_jacobian;
+				calibration.differentiate(times, quote_jacobian, discount_jacobian);
+				Matrix node_sensitivities = inverse(quote_jacobian);
+
+				for (Size i = 0; i < outputs_.size(); ++i) {
+					if (outputs_[i].base.get() != base) {
+						continue;
+					}
+					Array node_adjoint(discount_jacobian.columns(), 0.0);
+					for (const auto& [t, adjoint] : outputs_[i].base_adjoint) {
+						Size r = static_cast<Size>(std::lower_bound(times.begin(), times.end(), t) - times.begin());
+						for (Size k = 0; k < node_adjoint.size(); ++k) {
+							node_adjoint[k] += adjoint * discount_jacobian[r][k];
+						}
+					}
+					Array helper_deltas = node_adjoint * node_sensitivities;
+					for (Size h = 0; h < calibration.quotes.size(); ++h) {
+						if (calibration.quotes[h] < quotes_.size()) {
+							deltas_[i][calibration.quotes[h]] += helper_deltas[h];
+						}
+					}
+				}
+				probes.erase(probe);
+			}
+			if (probes.empty()) {
+				return;
+			}
+
+			// Other bases are bumped
+			auto sample = [&probes]() {
+				std::map<YieldTermStructure*, std::map<Time, DiscountFactor>> discounts;
+				for (const auto& [base, times] : probes) {
+					std::map<Time, DiscountFactor>& d = discounts[base];
+					for (Time t : times) {
+						d[t] = base->discount(t, true);
+					}
+				}
+				return discounts;
+			};
+
+			// A calculated, live base notifies its observers whenever one of its quotes moves; a frozen one does not
+			struct Notified : public Observer {
+				bool notified = false;
+				void update() override {
+					notified = true;
+				}
+			};
+			std::map<YieldTermStructure*, std::unique_ptr<Notified>> notified;
+			for (const Output& output : outputs_) {
+				if (probes.count(output.base.get()) == 0) {
+					continue;
+				}
+				auto& flag = notified[output.base.get()];
+				if (!flag) {
+					output.base->discount(0.0);
+					flag = std::make_unique<Notified>();
+					flag->registerWith(output.base);
+				}
+			}
+
+			for (Size j = 0; j < quotes_.size(); ++j) {
+				Real quote = quotes_[j]->value();
+				Real bump = relative_bump_ * std::max(std::abs(quote), 1.0);
+
+				try {
+					quotes_[j]->setValue(quote + bump);
+					auto up = sample();
+					quotes_[j]->setValue(quote - bump);
+					auto down = sample();
+					quotes_[j]->setValue(quote);
+
+					for (Size i = 0; i < outputs_.size(); ++i) {
+						if (probes.count(outputs_[i].base.get()) == 0) {
+							continue;
+						}
+						const std::map<Time, DiscountFactor>& d_up = up[outputs_[i].base.get()];
+						const std::map<Time, DiscountFactor>& d_down = down[outputs_[i].base.get()];
+						Real delta = 0.0;
+						for (const auto& [t, adjoint] : outputs_[i].base_adjoint) {
+							delta += adjoint * (d_up.at(t) - d_down.at(t)) / (2.0 * bump);
+						}
+						deltas_[i][j] = delta;
+					}
+				}
+				catch (...) {
+					quotes_[j]->setValue(quote);
+					throw;
+				}
+			}
+
+			for (const auto& [base, flag] : notified) {
+				if (!flag->notified) {
+					deltas_.clear();
+					throw std::runtime_error("QuoteSensitivities::calculate: a base curve without a calibration ignored every quote bump; it is frozen or does not observe the quotes.");
+				}
+			}
+		}
+
+		// d(output) / d(quote) for each quote, in the order given
+		const std::vector<Real>& deltas(Size output) const {
+			if (deltas_.empty()) {
+				throw std::runtime_error("QuoteSensitivities::deltas: not calculated.");
+			}
+			return deltas_.at(output);
+		}
+
+		Size size() const {
+			return outputs_.size();
+		}
+
+	private:
+		struct Output {
+			std::shared_ptr<YieldTermStructure> base;
+			DiscountAdjoint base_adjoint;
+		};
+
+		// The helpers of a piecewise base, each with the index of its quote in quotes_ (or quotes_.size()),
+		// and the Jacobians of their implied quotes and of the base's discount factors to its nodes
+		struct Calibration {
+			std::shared_ptr<YieldTermStructure> base;
+			std::vector<Size> quotes;
+			std::function<void(const std::vector<Time>&, Matrix&, Matrix&)> differentiate;
+		};
+
+		std::vector<std::shared_ptr<SimpleQuote>> quotes_;
+		Real relative_bump_;
+		std::map<YieldTermStructure*, Calibration> calibrations_;
+		std::vector<Output> outputs_;
+		std::vector<std::vector<Real>> deltas_;
+	};
+
+}
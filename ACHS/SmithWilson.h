@@ -0,0 +1,166 @@
+#pragma once
+#include "ExtensionMethod.h"
+#include <ql/quantlib.hpp>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+namespace ACHS {
+
+	using namespace QuantLib;
+
+	// Closed-form Smith-Wilson discount curve, P(t) = exp(-omega * t) + sum_j zeta_j * W(t, u_j),
+	// where omega is the continuously compounded ultimate forward rate and u_j are the liquid points.
+	class SmithWilsonCurve : public YieldTermStructure {
+	public:
+		SmithWilsonCurve(
+			const Date& reference_date,
+			const DayCounter& day_counter,
+			const Date& max_date,
+			Real omega,
+			Real alpha,
+			std::vector<Time> liquid_times,
+			std::vector<Real> zeta) :
+			YieldTermStructure(reference_date, Calendar(), day_counter),
+			max_date_(max_date), omega_(omega), alpha_(alpha),
+			liquid_times_(std::move(liquid_times)), zeta_(std::move(zeta)) {}
+
+		Date maxDate() const override {
+			return max_date_;
+		}
+
+		const std::vector<Time>& liquidTimes() const {
+			return liquid_times_;
+		}
+
+		Real omega() const {
+			return omega_;
+		}
+
+		Real alpha() const {
+			return alpha_;
+		}
+
+		// Wilson kernel W(t, u)
+		static Real wilson(Time t, Time u, Real omega, Real alpha) {
+			Time t_min = std::min(t, u);
+			Time t_max = std::max(t, u);
+			return std::exp(-omega * (t + u))
+				* (alpha * t_min - 0.5 * std::exp(-alpha * t_max) * (std::exp(alpha * t_min) - std::exp(-alpha * t_min)));
+		}
+
+	protected:
+		DiscountFactor discountImpl(Time t) const override {
+			DiscountFactor d = std::exp(-omega_ * t);
+			for (std::size_t j = 0; j < liquid_times_.size(); ++j) {
+				d += zeta_[j] * wilson(t, liquid_times_[j], omega_, alpha_);
+			}
+			return d;
+		}
+
+	private:
+		Date max_date_;
+		Real omega_;
+		Real alpha_;
+		std::vector<Time> liquid_times_;
+		std::vector<Real> zeta_;
+	};
+
+	// Smith-Wilson extrapolation to a continuously compounded ultimate forward rate, like the ultimate rates
+	// of the other methods. The liquid points run from step to start_period (annually by default) and are
+	// fitted exactly to the base curve's discount factors; beyond them the forward rate converges to the
+	// ultimate forward rate at speed alpha. The Wilson system is fitted to zero-coupon prices and converges
+	// in the forward rate whatever the trait, so the method has none of its own. The fit is made when the
+	// curve is built, so unlike the HybridCurve methods it does not follow later changes of the base.
+	class SmithWilson : public ExtensionMethod<SmithWilson, Traits::Forward> {
+		friend class ExtensionMethod<SmithWilson, Traits::Forward>;
+	public:
+		SmithWilson(
+			Rate ultimate_forward_rate,
+			Real alpha,
+			const Period& start_period,
+			const Period& end_period,
+			const Period& step = Period(1, Years)) :
+			ExtensionMethod<SmithWilson, Traits::Forward>(start_period, end_period, step),
+			ultimate_forward_rate_(ultimate_forward_rate), alpha_(alpha) {}
+
+	protected:
+		std::shared_ptr<YieldTermStructure> buildCurveImpl(
+			const std::shared_ptr<YieldTermStructure>& base) const {
+
+			DayCounter day_counter = base->dayCounter();
+
+			Date reference_date = base->referenceDate();
+
+			Date start_date = reference_date + start_period_;
+			Date end_date = reference_date + end_period_;
+
+			std::vector<Time> liquid_times;
+			for (Date d = reference_date + step_; d <= start_date; d += step_) {
+				liquid_times.push_back(day_counter.yearFraction(reference_date, d));
+			}
+			if (liquid_times.empty()) {
+				throw std::runtime_error("SmithWilson::buildCurveImpl: no liquid points before start period.");
+			}
+
+			Real omega = ultimate_forward_rate_;
+
+			Size n = liquid_times.size();
+			Matrix w(n, n);
+			Array excess(n);
+			for (Size i = 0; i < n; ++i) {
+				for (Size j = 0; j < n; ++j) {
+					w[i][j] = SmithWilsonCurve::wilson(liquid_times[i], liquid_times[j], omega, alpha_);
+				}
+				excess[i] = base->discount(liquid_times[i]) - std::exp(-omega * liquid_times[i]);
+			}
+
+			// W is symmetric positive definite: solve W zeta = p - mu by Cholesky rather than inverting it
+			Array zeta = CholeskySolveFor(CholeskyDecomposition(w), excess);
+
+			return std::make_shared<SmithWilsonCurve>(
+				reference_date,
+				day_counter,
+				end_date,
+				omega,
+				alpha_,
+				liquid_times,
+				std::vector<Real>(zeta.begin(), zeta.end()));
+		}
+
+		// zeta = W^-1 (p - mu) with W symmetric, so the adjoint of the fitted prices is W^-1 applied to the
+		// kernel-weighted curve adjoint
+		void adjointImpl(
+			const std::shared_ptr<YieldTermStructure>&,
+			const YieldTermStructure& curve,
+			const DiscountAdjoint& curve_adjoint,
+			DiscountAdjoint& base_adjoint) const {
+
+			const auto& smith_wilson = dynamic_cast<const SmithWilsonCurve&>(curve);
+			const std::vector<Time>& liquid_times = smith_wilson.liquidTimes();
+			Real omega = smith_wilson.omega();
+			Real alpha = smith_wilson.alpha();
+
+			Size n = liquid_times.size();
+			Matrix w(n, n);
+			Array zeta_adjoint(n, 0.0);
+			for (Size i = 0; i < n; ++i) {
+				for (Size j = 0; j < n; ++j) {
+					w[i][j] = SmithWilsonCurve::wilson(liquid_times[i], liquid_times[j], omega, alpha);
+				}
+				for (const auto& [t, d_adjoint] : curve_adjoint) {
+					zeta_adjoint[i] += d_adjoint * SmithWilsonCurve::wilson(t, liquid_times[i], omega, alpha);
+				}
+			}
+
+			Array price_adjoint = CholeskySolveFor(CholeskyDecomposition(w), zeta_adjoint);
+			for (Size i = 0; i < n; ++i) {
+				base_adjoint.add(liquid_times[i], price_adjoint[i]);
+			}
+		}
+	private:
+		Rate ultimate_forward_rate_;
+		Real alpha_;
+
+	};
+
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+namespace ACHS {
+
+	// Fixed-size pool of worker threads. Tasks run in submission order; the destructor finishes queued tasks.
+	class ThreadPool {
+	public:
+		explicit ThreadPool(std::size_t threads) {
+			for (std::size_t i = 0; i < (threads == 0 ? 1 : threads); ++i) {
+				workers_.emplace_back([this]() { work(); });
+			}
+		}
+
+		~ThreadPool() {
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				stopping_ = true;
+			}
+			ready_.notify_all();
+			for (std::thread& worker : workers_) {
+				worker.join();
+			}
+		}
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		template<typename F>
+		std::future<void> submit(F f) {
+			auto task = std::make_shared<std::packaged_task<void()>>(std::move(f));
+			std::future<void> result = task->get_future();
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				tasks_.push([task]() { (*task)(); });
+			}
+			ready_.notify_one();
+			return result;
+		}
+
+		std::size_t size() const {
+			return workers_.size();
+		}
+
+	private:
+		std::vector<std::thread> workers_;
+		std::queue<std::function<void()>> tasks_;
+		bool stopping_ = false;
+		std::mutex mutex_;
+		std::condition_variable ready_;
+
+		void work() {
+			for (;;) {
+				std::function<void()> task;
+				{
+					std::unique_lock<std::mutex> lock(mutex_);
+					ready_.wait(lock, [this]() { return stopping_ || !tasks_.empty(); });
+					if (tasks_.empty()) {
+						return;
+					}
+					task = std::move(tasks_.front());
+					tasks_.pop();
+				}
+				task();
+			}
+		}
+	};
+
+}
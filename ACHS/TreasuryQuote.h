@@ -12,6 +12,8 @@ namespace ACHS {
 	public:
 		TreasuryQuote(Real quote, Rate rate, const Period& tenor) : quote_(quote), rate_(rate), tenor_(tenor) {
 			frequency_ = isDepositRate() ? Once : Semiannual;
+			price_quote_ = std::make_shared<SimpleQuote>(quote_);
+			rate_quote_ = std::make_shared<SimpleQuote>(rate_ / 100.0);
 		}
 		Real quote() const {
 			return quote_;
@@ -26,6 +28,22 @@ namespace ACHS {
 			return tenor_ <= Period(1, Years);
 		}
 
+		// Market quote a helper of the given type is built on: the deposit rate for short tenors under
+		// RateHelper and the clean price otherwise. Helpers made from this TreasuryQuote, or copies of it,
+		// share the quote, so setting it moves every curve bootstrapped from them.
+		template<typename HelperType>
+		std::shared_ptr<SimpleQuote> marketQuote() const {
+			if constexpr (std::is_same_v<HelperType, BondHelper>) {
+				return price_quote_;
+			}
+			else if constexpr (std::is_same_v<HelperType, RateHelper>) {
+				return isDepositRate() ? rate_quote_ : price_quote_;
+			}
+			else {
+				static_assert(always_false<HelperType>, "TreasuryQuote::marketQuote: unsupported HelperType.");
+			}
+		}
+
 		template<typename HelperType> 
 		std::shared_ptr<HelperType> makeHelper() const {
 			if constexpr (std::is_same_v<HelperType, BondHelper>) {
@@ -55,6 +73,9 @@ namespace ACHS {
 		DateGeneration::Rule rule_ = DateGeneration::Forward;
 		bool end_of_month_ = false;
 
+		std::shared_ptr<SimpleQuote> price_quote_;
+		std::shared_ptr<SimpleQuote> rate_quote_;
+
 		std::shared_ptr<BondHelper> makeBondHelperImpl() const {
 			Date reference_date = Settings::instance().evaluationDate();
 			Date maturity_date = calendar_.advance(reference_date, tenor_);
@@ -71,7 +92,7 @@ namespace ACHS {
 				end_of_month_);
 			
 			return std::make_shared<FixedRateBondHelper>(
-				Handle<Quote>(std::make_shared<SimpleQuote>(quote_)),
+				Handle<Quote>(price_quote_),
 				settlement_days_,
 				100.0,
 				schedule,
@@ -82,9 +103,8 @@ namespace ACHS {
 		}
 
 		std::shared_ptr<RateHelper> makeRateHelperImpl() const {
-			Rate deposit_rate = rate_ / 100.0;
 			return std::make_shared<DepositRateHelper>(
-				Handle<Quote>(std::make_shared<SimpleQuote>(deposit_rate)),
+				Handle<Quote>(rate_quote_),
 				tenor_,
 				settlement_days_,
 				calendar_,
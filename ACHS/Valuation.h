@@ -0,0 +1,89 @@
+#pragma once
+#include "DiscountAdjoint.h"
+#include <ql/quantlib.hpp>
+namespace ACHS {
+
+	using namespace QuantLib;
+
+	// Direct valuation against a curve, bypassing pricing engines, handles and observer notifications.
+
+	// Present value of a leg as of the evaluation date, as CashFlows::npv with the settlement date defaulted
+	inline Real discountedValue(const Leg& leg, const YieldTermStructure& curve) {
+		return CashFlows::npv(leg, curve, false);
+	}
+
+	// Present value of a bond's flows as DiscountingBondEngine computes it, as of the curve's reference date
+	inline Real discountedValue(const Bond& bond, const YieldTermStructure& curve) {
+		Date npv_date = curve.referenceDate();
+		return CashFlows::npv(bond.cashflows(), curve, Settings::instance().includeReferenceDateEvents(), npv_date, npv_date);
+	}
+
+	// Adjoints of discountedValue: accumulate value_adjoint * dV/dD(t) over the curve times the value reads
+
+	inline void discountedValueAdjoint(const Leg& leg, const YieldTermStructure& curve, Real value_adjoint, DiscountAdjoint& adjoint) {
+		// V = sum_i c_i D(t_i) / D(t_0), discounted to the evaluation date t_0
+		Date npv_date = Settings::instance().evaluationDate();
+		Time t0 = curve.timeFromReference(npv_date);
+		DiscountFactor d0 = curve.discount(t0);
+		Real npv = 0.0;
+		for (const std::shared_ptr<CashFlow>& cf : leg) {
+			if (cf->hasOccurred(npv_date, false) || cf->tradingExCoupon(npv_date)) {
+				continue;
+			}
+			Time t = curve.timeFromReference(cf->date());
+			npv += cf->amount() * curve.discount(t);
+			adjoint.add(t, value_adjoint * cf->amount() / d0);
+		}
+		adjoint.add(t0, -value_adjoint * npv / (d0 * d0));
+	}
+
+	// Discounted to the curve's reference date, where D is identically one
+	inline void discountedValueAdjoint(const Bond& bond, const YieldTermStructure& curve, Real value_adjoint, DiscountAdjoint& adjoint) {
+		Date npv_date = curve.referenceDate();
+		bool include = Settings::instance().includeReferenceDateEvents();
+		for (const std::shared_ptr<CashFlow>& cf : bond.cashflows()) {
+			if (cf->hasOccurred(npv_date, include) || cf->tradingExCoupon(npv_date)) {
+				continue;
+			}
+			adjoint.add(curve.timeFromReference(cf->date()), value_adjoint * cf->amount());
+		}
+	}
+
+	// Values on a curve and on its zero-rate shifts of +/- spread
+	struct ShiftedValues {
+		Real value;
+		Real up;
+		Real down;
+	};
+
+	// Adds one flow, of present value pv on the curve, to values; shift is exp(-spread * t), the relative
+	// discount factor of the upward shift at the flow's time t from the date values are discounted to
+	inline void addShiftedFlow(ShiftedValues& values, Real pv, Real shift) {
+		values.value += pv;
+		values.up += pv * shift;
+		values.down += pv / shift;
+	}
+
+	// Values of a leg or bond on a curve and its shifted curves, such as a CurveRegistry entry
+	template<typename Instrument, typename Curves>
+	ShiftedValues shiftedValues(const Instrument& instrument, const Curves& curves) {
+		return { discountedValue(instrument, *curves.curve), discountedValue(instrument, *curves.curve_up), discountedValue(instrument, *curves.curve_down) };
+	}
+
+	// Effective duration and convexity from values under parallel zero-rate shifts of +/- spread. Nothing
+	// left to value, as after a projection rolls past the last flow, has zero duration and convexity.
+	inline Real effectiveDuration(Real base, Real up, Real down, Spread spread) {
+		if (base == 0.0) {
+			return 0.0;
+		}
+		return -(up - down) / (2.0 * base * spread);
+	}
+
+	inline Real effectiveConvexity(Real base, Real up, Real down, Spread spread) {
+		if (base == 0.0) {
+			return 0.0;
+		}
+		return (up + down - 2.0 * base) / (base * spread * spread);
+	}
+
+}
@@ -0,0 +1,662 @@
+#include <ql/quantlib.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ExtensionMethod.h"
+#include "ExtendedCurve.h"
+#include "ExtendedCurves.h"
+#include "Valuation.h"
+#include "Sensitivities.h"
+#include "RollForward.h"
+#include "ConcurrentCurves.h"
+#include "ScenarioFile.h"
+#include "Immunization.h"
+#include "ParameterSweep.h"
+
+#include "CurveSetup.h"
+
+// Benchmarks for curve construction, extension and valuation.
+//
+//   ACHSBenchmarks [--filter <substring>] [--min-time <seconds>] [--out <results.csv>]
+//                  [--baseline <baseline.csv>] [--tolerance <fraction>] [--adjoint-tolerance <fraction>]
+//
+// Results are written as CSV (Benchmark,Parameter,Iterations,NsPerOp). With --baseline, each result is
+// compared against the stored run and the exit code is 1 if any benchmark is slower by more than the
+// tolerance (10% by default). The exit code is also 1 if a behaviour check fails: adjoint quote deltas
+// that differ from bump-and-reprice by more than --adjoint-tolerance, relative to the largest delta (1e-5
+// by default), a Smith-Wilson curve that misses the base at its liquid points or the ultimate rate, or a
+// roll-forward to the reference date that does not reproduce the same-day valuation.
+
+using namespace QuantLib;
+using namespace ACHS;
+
+namespace {
+
+    struct Result {
+        std::string name;
+        std::string parameter;
+        std::size_t iterations;
+        double ns_per_op;
+    };
+
+    struct Options {
+        std::string filter;
+        double min_time = 0.2;
+        std::string out = "benchmarks.csv";
+        std::string baseline;
+        double tolerance = 0.10;
+        double adjoint_tolerance = 1.0e-5;
+    };
+
+    class Runner {
+    public:
+        explicit Runner(const Options& options) : options_(options) {}
+
+        // Times f in batches of doubling size until a batch lasts min_time; reports the best of three batches
+        template<typename F>
+        void run(const std::string& name, const std::string& parameter, F&& f) {
+            std::string key = name + "/" + parameter;
+            if (!options_.filter.empty() && key.find(options_.filter) == std::string::npos) {
+                return;
+            }
+
+            using clock = std::chrono::steady_clock;
+            f(); // warm up lazy calculations and caches
+
+            std::size_t iterations = 1;
+            double elapsed = 0.0;
+            for (;;) {
+                auto start = clock::now();
+                for (std::size_t i = 0; i < iterations; ++i) {
+                    f();
+                }
+                elapsed = std::chrono::duration<double>(clock::now() - start).count();
+                if (elapsed >= options_.min_time || iterations >= (std::size_t(1) << 30)) {
+                    break;
+                }
+                iterations *= 2;
+            }
+
+            double best = elapsed;
+            for (int repeat = 0; repeat < 2; ++repeat) {
+                auto start = clock::now();
+                for (std::size_t i = 0; i < iterations; ++i) {
+                    f();
+                }
+                best = std::min(best, std::chrono::duration<double>(clock::now() - start).count());
+            }
+
+            Result result{ name, parameter, iterations, best * 1.0e9 / iterations };
+            std::cout << std::left << std::setw(56) << key << std::right << std::setw(16)
+                << std::fixed << std::setprecision(1) << result.ns_per_op << " ns/op" << std::endl;
+            results_.push_back(result);
+        }
+
+        const std::vector<Result>& results() const {
+            return results_;
+        }
+
+    private:
+        Options options_;
+        std::vector<Result> results_;
+    };
+
+    // Keeps the optimizer from discarding benchmarked work
+    volatile double sink = 0.0;
+
+    // Monthly liability flows of 1,000,000 each, starting one month after today; at most 1200 to stay
+    // within the 100-year extended curves
+    Leg liabilityLeg(const Date& today, Size flows) {
+        Leg leg;
+        for (Size m = 1; m <= flows; ++m) {
+            leg.push_back(std::make_shared<SimpleCashFlow>(1000000.0, today + Period(static_cast<Integer>(m), Months)));
+        }
+        return leg;
+    }
+
+    std::vector<Result> readResults(const std::string& filename) {
+        std::ifstream file(filename);
+        if (!file.is_open()) {
+            throw std::runtime_error("readResults: failed to open CSV file: " + filename + ".");
+        }
+
+        std::vector<Result> results;
+        std::string line;
+        std::getline(file, line); // skip header
+
+        while (std::getline(file, line)) {
+            std::istringstream ss(line);
+            std::string name, parameter, iterations, ns_per_op;
+            std::getline(ss, name, ',');
+            std::getline(ss, parameter, ',');
+            std::getline(ss, iterations, ',');
+            std::getline(ss, ns_per_op, ',');
+            results.push_back({ name, parameter, std::stoul(iterations), std::stod(ns_per_op) });
+        }
+        return results;
+    }
+
+    void writeResults(const std::string& filename, const std::vector<Result>& results) {
+        std::ofstream out(filename);
+        out << "Benchmark,Parameter,Iterations,NsPerOp\n";
+        for (const Result& result : results) {
+            out << result.name << "," << result.parameter << "," << result.iterations << ","
+                << std::fixed << std::setprecision(3) << result.ns_per_op << "\n";
+        }
+    }
+
+    // Prints the ratio to the baseline for every benchmark present in both runs; returns the regression count
+    int compare(const std::vector<Result>& results, const std::vector<Result>& baseline, double tolerance) {
+        std::map<std::string, double> previous;
+        for (const Result& result : baseline) {
+            previous[result.name + "/" + result.parameter] = result.ns_per_op;
+        }
+
+        int regressions = 0;
+        std::cout << "\nComparison against baseline (tolerance " << tolerance * 100.0 << "%)\n";
+        for (const Result& result : results) {
+            std::string key = result.name + "/" + result.parameter;
+            auto it = previous.find(key);
+            if (it == previous.end()) {
+                continue;
+            }
+            double ratio = result.ns_per_op / it->second;
+            bool regressed = ratio > 1.0 + tolerance;
+            regressions += regressed ? 1 : 0;
+            std::cout << std::left << std::setw(56) << key << std::right << std::setw(10)
+                << std::fixed << std::setprecision(3) << ratio << "x" << (regressed ? "  REGRESSION" : "") << "\n";
+        }
+        return regressions;
+    }
+
+    Options parseOptions(int argc, char* argv[]) {
+        Options options;
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            auto value = [&]() -> std::string {
+                if (i + 1 >= argc) {
+                    throw std::runtime_error("parseOptions: missing value for " + arg + ".");
+                }
+                return argv[++i];
+            };
+
+            if (arg == "--filter") options.filter = value();
+            else if (arg == "--min-time") options.min_time = std::stod(value());
+            else if (arg == "--out") options.out = value();
+            else if (arg == "--baseline") options.baseline = value();
+            else if (arg == "--tolerance") options.tolerance = std::stod(value());
+            else if (arg == "--adjoint-tolerance") options.adjoint_tolerance = std::stod(value());
+            else throw std::runtime_error("parseOptions: unknown option " + arg + ".");
+        }
+        return options;
+    }
+
+    // Directory for generated input files, removed with everything in it when it goes out of scope
+    class ScratchDirectory {
+    public:
+        ScratchDirectory() {
+            path_ = std::filesystem::temp_directory_path()
+                / ("achs-benchmarks-" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()));
+            std::filesystem::create_directories(path_);
+        }
+
+        ~ScratchDirectory() {
+            std::error_code ignored;
+            std::filesystem::remove_all(path_, ignored);
+        }
+
+        ScratchDirectory(const ScratchDirectory&) = delete;
+        ScratchDirectory& operator=(const ScratchDirectory&) = delete;
+
+        std::string file(const std::string& name) const {
+            return (path_ / name).string();
+        }
+
+    private:
+        std::filesystem::path path_;
+    };
+
+    // Largest difference between the adjoint quote deltas of the leg value on one extension of base, with
+    // the bootstrap differentiated through the given calibration helpers, and central differences of full
+    // reprices, relative to the largest delta
+    template<typename Traits, typename Interpolator>
+    Real adjointMismatch(const Extension& extend, const std::shared_ptr<PiecewiseYieldCurve<Traits, Interpolator>>& base,
+        const std::vector<std::shared_ptr<RateHelper>>& helpers, const std::vector<std::shared_ptr<SimpleQuote>>& quotes,
+        const Leg& leg, Real relative_bump = 1.0e-4) {
+
+        QuoteSensitivities sensitivities(quotes, relative_bump);
+        sensitivities.addCalibration(base, helpers);
+        sensitivities.addValue(*extend(base), leg);
+        sensitivities.calculate();
+        const std::vector<Real>& adjoint = sensitivities.deltas(0);
+
+        std::vector<Real> bumped;
+        for (const auto& quote : quotes) {
+            Real value = quote->value();
+            Real bump = relative_bump * std::max(std::abs(value), 1.0);
+            quote->setValue(value + bump);
+            Real up = discountedValue(leg, *extend(base)->curve());
+            quote->setValue(value - bump);
+            Real down = discountedValue(leg, *extend(base)->curve());
+            quote->setValue(value);
+            bumped.push_back((up - down) / (2.0 * bump));
+        }
+
+        Real scale = 0.0;
+        Real mismatch = 0.0;
+        for (Size j = 0; j < quotes.size(); ++j) {
+            scale = std::max(scale, std::abs(bumped[j]));
+            mismatch = std::max(mismatch, std::abs(adjoint[j] - bumped[j]));
+        }
+        return scale > 0.0 ? mismatch / scale : mismatch;
+    }
+
+    // Prints the error of one behaviour check; returns whether it exceeds the tolerance
+    bool check(const std::string& name, Real error, Real tolerance) {
+        bool failed = !(error <= tolerance);
+        std::cout << std::left << std::setw(56) << name << std::right << std::setw(10)
+            << std::scientific << std::setprecision(2) << error << (failed ? "  FAILED" : "") << "\n";
+        return failed;
+    }
+
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        Options options = parseOptions(argc, argv);
+        Runner runner(options);
+
+        Date today(31, Dec, 2024);
+        Settings::instance().evaluationDate() = today;
+
+        auto bases = baseFactories(treasuryQuotes(), today);
+        auto methods = extensionMethods();
+
+        // Base-curve construction, including the bootstrap or fit
+        for (const auto& [name, factory] : bases) {
+            runner.run("BaseCurve", name, [&]() {
+                auto curve = factory();
+                sink = sink + curve->discount(1.0);
+            });
+        }
+
+        std::vector<std::pair<std::string, std::shared_ptr<YieldTermStructure>>> built;
+        for (const auto& [name, factory] : bases) {
+            auto curve = factory();
+            curve->enableExtrapolation();
+            curve->discount(1.0);
+            built.emplace_back(name, curve);
+        }
+
+        // Rate extraction and extension construction on calculated bases
+        for (const auto& [name, curve] : built) {
+            runner.run("ExtractRateZero", name, [&]() {
+                for (int m = 1; m <= 360; ++m) {
+                    sink = sink + extractRate<Traits::Zero>(curve, m / 12.0);
+                }
+            });
+            runner.run("ExtractRateForward", name, [&]() {
+                for (int m = 1; m <= 360; ++m) {
+                    sink = sink + extractRate<Traits::Forward>(curve, m / 12.0);
+                }
+            });
+            for (const auto& [method, extend] : methods) {
+                runner.run("BuildCurve", name + ":" + method, [&]() {
+                    auto wrapper = extend(curve);
+                    sink = sink + wrapper->curve()->discount(50.0);
+                });
+            }
+        }
+
+        // ExtendedCurves valuation on every extended curve
+        ExtendedCurves curves(0.001);
+        for (const auto& [name, curve] : built) {
+            for (const auto& [method, extend] : methods) {
+                curves.addOrUpdate(name + ":" + method, extend(curve));
+            }
+        }
+
+        Leg leg = liabilityLeg(today, 1200);
+        std::vector<std::shared_ptr<Bond>> bonds;
+        for (Integer years : { 5, 10, 20, 30 }) {
+            bonds.push_back(makeBond(today, Period(years, Years)));
+        }
+
+        const CurveRegistry& registry = curves.registry();
+        auto valueAll = [&](auto&& value) {
+            for (Size i = 0; i < registry.size(); ++i) {
+                if (registry.contains(i)) {
+                    curves.setActiveCurve(i);
+                    value();
+                }
+            }
+        };
+
+        for (bool frozen : { false, true }) {
+            if (frozen) {
+                curves.freeze();
+            }
+            std::string mode = frozen ? "frozen" : "observed";
+            for (const auto& bond : bonds) {
+                curves.linkToActiveCurve(bond);
+            }
+            runner.run("LegNPV", mode, [&]() { valueAll([&]() { sink = sink + curves.NPV(leg); }); });
+            runner.run("LegDuration", mode, [&]() { valueAll([&]() { sink = sink + curves.duration(leg); }); });
+            runner.run("LegConvexity", mode, [&]() { valueAll([&]() { sink = sink + curves.convexity(leg); }); });
+            runner.run("BondNPV", mode, [&]() { valueAll([&]() { for (const auto& bond : bonds) sink = sink + curves.NPV(bond); }); });
+            runner.run("BondDuration", mode, [&]() { valueAll([&]() { for (const auto& bond : bonds) sink = sink + curves.duration(bond); }); });
+            runner.run("BondConvexity", mode, [&]() { valueAll([&]() { for (const auto& bond : bonds) sink = sink + curves.convexity(bond); }); });
+        }
+
+        // Scaling in the number of curves: build and value n extended curves
+        for (Size n : { 6, 66, 660 }) {
+            runner.run("ScaleCurves", std::to_string(n), [&]() {
+                ExtendedCurves scaled(0.001);
+                // Each block of bases x methods repeats the bases under new names
+                Size per_block = built.size() * methods.size();
+                for (Size i = 0; i < n; ++i) {
+                    const auto& [name, curve] = built[(i / methods.size()) % built.size()];
+                    const auto& [method, extend] = methods[i % methods.size()];
+                    std::string block = std::to_string(i / per_block);
+                    scaled.addOrUpdate(name + "#" + block + ":" + method, extend(curve));
+                }
+                scaled.freeze();
+                const CurveRegistry& scaled_registry = scaled.registry();
+                for (Size i = 0; i < scaled_registry.size(); ++i) {
+                    if (scaled_registry.contains(i)) {
+                        scaled.setActiveCurve(i);
+                        sink = sink + scaled.duration(leg);
+                    }
+                }
+            });
+        }
+
+        // Scaling in the liability cash-flow count
+        for (Size flows : { 12, 60, 300, 1200 }) {
+            Leg scaled_leg = liabilityLeg(today, flows);
+            runner.run("ScaleCashFlows", std::to_string(flows), [&]() {
+                valueAll([&]() { sink = sink + curves.duration(scaled_leg); });
+            });
+        }
+
+        // Scaling in threads: frozen curves valued concurrently, each thread taking a strided share
+        unsigned max_threads = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned threads = 1; threads <= max_threads; threads *= 2) {
+            runner.run("ScaleThreads", std::to_string(threads), [&]() {
+                std::vector<std::thread> workers;
+                std::vector<double> totals(threads, 0.0);
+                for (unsigned w = 0; w < threads; ++w) {
+                    workers.emplace_back([&, w]() {
+                        for (Size i = w; i < registry.size(); i += threads) {
+                            if (registry.contains(i)) {
+                                const CurveRegistry::Entry& entry = registry[i];
+                                totals[w] += discountedValue(leg, *entry.curve)
+                                    + discountedValue(leg, *entry.curve_up)
+                                    + discountedValue(leg, *entry.curve_down);
+                            }
+                        }
+                    });
+                }
+                for (auto& worker : workers) {
+                    worker.join();
+                }
+                for (double total : totals) {
+                    sink = sink + total;
+                }
+            });
+        }
+
+        // Concurrent valuation while a writer republishes one base's extensions as a single update
+        ConcurrentCurves concurrent(0.001);
+        std::vector<std::pair<std::string, std::shared_ptr<ExtendedCurveWrapper>>> published;
+        for (const auto& [name, curve] : built) {
+            for (const auto& [method, extend] : methods) {
+                published.emplace_back(name + ":" + method, extend(curve));
+            }
+        }
+        concurrent.addOrUpdate(published);
+
+        for (bool writing : { false, true }) {
+            runner.run("ConcurrentReads", writing ? "writer" : "idle", [&]() {
+                std::atomic<bool> done{ false };
+                std::thread writer;
+                if (writing) {
+                    writer = std::thread([&]() {
+                        while (!done.load()) {
+                            std::vector<std::pair<std::string, std::shared_ptr<ExtendedCurveWrapper>>> refreshed;
+                            for (const auto& [method, extend] : methods) {
+                                refreshed.emplace_back(built.front().first + ":" + method, extend(built.front().second));
+                            }
+                            concurrent.addOrUpdate(refreshed);
+                        }
+                    });
+                }
+
+                std::vector<std::thread> readers;
+                std::vector<double> totals(max_threads, 0.0);
+                for (unsigned w = 0; w < max_threads; ++w) {
+                    readers.emplace_back([&, w]() {
+                        ConcurrentCurves::Reader reader = concurrent.read();
+                        const CurveRegistry& snapshot = reader.registry();
+                        for (Size i = w; i < snapshot.size(); i += max_threads) {
+                            if (snapshot.contains(i)) {
+                                reader.setActiveCurve(i);
+                                totals[w] += reader.duration(leg);
+                            }
+                        }
+                    });
+                }
+                for (auto& reader : readers) {
+                    reader.join();
+                }
+                done.store(true);
+                if (writer.joinable()) {
+                    writer.join();
+                }
+                for (double total : totals) {
+                    sink = sink + total;
+                }
+            });
+        }
+
+        // Deltas of the leg and bond values on every extension of one live base to all quotes: adjoint
+        // sweeps plus one differentiation of the bootstrap, against bumping each quote and rebuilding everything
+        std::vector<TreasuryQuote> quotes = treasuryQuotes();
+        std::vector<std::shared_ptr<RateHelper>> live_helpers;
+        std::vector<std::shared_ptr<RateHelper>> calibration_helpers;
+        std::vector<std::shared_ptr<SimpleQuote>> market_quotes;
+        for (const TreasuryQuote& quote : quotes) {
+            live_helpers.push_back(quote.makeHelper<RateHelper>());
+            calibration_helpers.push_back(quote.makeHelper<RateHelper>());
+            market_quotes.push_back(quote.marketQuote<RateHelper>());
+        }
+        auto live_base = std::make_shared<PiecewiseYieldCurve<ZeroYield, Linear>>(today, live_helpers, ActualActual(ActualActual::Actual365));
+        live_base->enableExtrapolation();
+
+        runner.run("QuoteDeltas", "adjoint", [&]() {
+            QuoteSensitivities sensitivities(market_quotes);
+            sensitivities.addCalibration(live_base, calibration_helpers);
+            for (const auto& [method, extend] : methods) {
+                auto wrapper = extend(live_base);
+                sensitivities.addValue(*wrapper, leg);
+                for (const auto& bond : bonds) {
+                    sensitivities.addValue(*wrapper, *bond);
+                }
+            }
+            sensitivities.calculate();
+            sink = sink + sensitivities.deltas(0).front();
+        });
+
+        runner.run("QuoteDeltas", "bumped", [&]() {
+            for (const auto& quote : market_quotes) {
+                Real value = quote->value();
+                Real bump = 1.0e-4 * std::max(std::abs(value), 1.0);
+                for (Real shifted : { value + bump, value - bump }) {
+                    quote->setValue(shifted);
+                    for (const auto& [method, extend] : methods) {
+                        auto wrapper = extend(live_base);
+                        sink = sink + discountedValue(leg, *wrapper->curve());
+                        for (const auto& bond : bonds) {
+                            sink = sink + discountedValue(*bond, *wrapper->curve());
+                        }
+                    }
+                }
+                quote->setValue(value);
+            }
+        });
+
+        // The adjoint deltas above must agree with bump-and-reprice; checked for a zero-rate method, a
+        // forward-rate method and Smith-Wilson whatever the filter
+        std::cout << "\nAdjoint deltas against bump-and-reprice (tolerance " << options.adjoint_tolerance << ")\n";
+        int failures = 0;
+        for (const auto& [method, extend] : methods) {
+            if (method != "FLAT_ZERO" && method != "LINEARLY_GRADED_FORWARD" && method != "SMITH_WILSON") {
+                continue;
+            }
+            failures += check(method, adjointMismatch(extend, live_base, calibration_helpers, market_quotes, leg), options.adjoint_tolerance) ? 1 : 0;
+        }
+
+        // Smith-Wilson on every base must reprice the base's discount factors at the liquid points, and its
+        // forward rate must reach the ultimate forward rate 30 / alpha years after the last liquid point
+        std::cout << "\nSmith-Wilson fit to the liquid points and convergence to the ultimate forward rate\n";
+        for (const auto& [name, curve] : built) {
+            auto fitted = std::dynamic_pointer_cast<SmithWilsonCurve>(
+                SmithWilson(Rate(0.05), 0.1, Period(30, Years), Period(100, Years)).buildCurve(curve));
+            Real fit = 0.0;
+            for (Time u : fitted->liquidTimes()) {
+                fit = std::max(fit, std::abs(fitted->discount(u) / curve->discount(u) - 1.0));
+            }
+            Time converged = fitted->liquidTimes().back() + 30.0 / fitted->alpha();
+            Rate forward = fitted->forwardRate(converged, converged + 1.0 / 365.0, Continuous, NoFrequency, true).rate();
+            failures += check(name + " liquid points", fit, 1.0e-8) ? 1 : 0;
+            failures += check(name + " ultimate forward rate", std::abs(forward - fitted->omega()), 1.0e-6) ? 1 : 0;
+        }
+
+        // Monthly 30-year surplus projection on one base, rolled forward instead of rebuilt
+        std::vector<std::pair<std::shared_ptr<Bond>, Real>> assets;
+        for (const auto& bond : bonds) {
+            assets.emplace_back(bond, 10000.0);
+        }
+        runner.run("RollForward", "360", [&]() {
+            RollForward<Flat<Traits::Forward>> projection(
+                built.front().second, Flat<Traits::Forward>(Period(30, Years), Period(100, Years)), leg, assets, 0.001);
+            for (const ProjectionStep& step : projection.project(Period(30, Years))) {
+                sink = sink + step.surplus;
+            }
+        });
+
+        // Rolling to the reference date must reproduce the same-day valuation on the extended curve
+        std::cout << "\nRoll-forward to the reference date against same-day valuation\n";
+        {
+            Flat<Traits::Forward> flat(Period(30, Years), Period(100, Years));
+            const std::shared_ptr<YieldTermStructure>& base = built.front().second;
+            RollForward<Flat<Traits::Forward>> projection(base, flat, leg, assets, 0.001);
+            ProjectionStep step = projection.advance(base->referenceDate());
+
+            std::shared_ptr<YieldTermStructure> extended = flat.buildCurve(base);
+            Real liability_value = discountedValue(leg, *extended);
+            Real asset_value = 0.0;
+            for (const auto& [bond, quantity] : assets) {
+                asset_value += quantity * discountedValue(*bond, *extended);
+            }
+            failures += check("liabilities", std::abs(step.liability_value / liability_value - 1.0), 1.0e-12) ? 1 : 0;
+            failures += check("assets", std::abs(step.asset_value / asset_value - 1.0), 1.0e-12) ? 1 : 0;
+        }
+
+        // Streaming valuation of 1000 monthly scenario paths from CSV and from the binary layout
+        ScratchDirectory scratch;
+        {
+            std::ofstream scenarios(scratch.file("scenarios.csv"));
+            scenarios << "ScenarioId";
+            for (int m = 1; m <= 1200; ++m) {
+                scenarios << "," << m / 12.0;
+            }
+            scenarios << "\n" << std::setprecision(8);
+            for (int id = 1; id <= 1000; ++id) {
+                scenarios << id;
+                for (int m = 1; m <= 1200; ++m) {
+                    scenarios << "," << 0.03 + 0.00001 * id + 0.00002 * m;
+                }
+                scenarios << "\n";
+            }
+        }
+        ScenarioFile<Traits::Zero>(scratch.file("scenarios.csv"), today, ActualActual(ActualActual::Actual365)).writeBinary(scratch.file("scenarios.bin"));
+
+        for (std::string format : { "csv", "bin" }) {
+            runner.run("ScenarioChunks", format, [&]() {
+                ScenarioFile<Traits::Zero> file(scratch.file("scenarios." + format), today, ActualActual(ActualActual::Actual365));
+                file.forEachChunk(256, [&](const ScenarioChunk<Traits::Zero>& chunk) {
+                    for (Size i = 0; i < chunk.size(); ++i) {
+                        sink = sink + discountedValue(leg, *chunk.curve(i));
+                    }
+                });
+            });
+        }
+
+        // Immunization: sensitivities of the candidate bonds and liabilities on every curve, then the solve
+        std::vector<Time> key_rate_times = { 2.0, 5.0, 10.0, 20.0, 30.0 };
+        runner.run("ImmunizationMatrix", std::to_string(registry.size()), [&]() {
+            SensitivityMatrix matrix(bonds, leg, registry, key_rate_times);
+            sink = sink + matrix.liability(0, SensitivityMatrix::value);
+        });
+        SensitivityMatrix matrix(bonds, leg, registry, key_rate_times);
+        runner.run("Immunize", "parallel", [&]() {
+            sink = sink + immunize(matrix).rms_error;
+        });
+        runner.run("Immunize", "key-rate", [&]() {
+            ImmunizationOptions key_rates;
+            key_rates.metric_weights.assign(matrix.metricCount(), 1.0);
+            sink = sink + immunize(matrix, key_rates).rms_error;
+        });
+
+        // Assumption sweep over ultimate rates and grading periods, shared base work against rebuilding each variant
+        auto grid = parameterGrid(
+            std::vector<Rate>{ 0.030, 0.0325, 0.035, 0.0375, 0.040, 0.0425, 0.045, 0.0475, 0.050 },
+            std::vector<Period>{ Period(20, Years), Period(30, Years) },
+            std::vector<Period>{ Period(40, Years), Period(50, Years), Period(60, Years) },
+            std::vector<Period>{ Period(100, Years) });
+        runner.run("ParameterSweep", "shared", [&]() {
+            ParameterSweep sweep(built.front().second, leg, assets, 0.001);
+            for (const SweepPoint& point : sweep.run<LinearlyGraded<Traits::Forward>>(grid)) {
+                sink = sink + point.surplus;
+            }
+        });
+        runner.run("ParameterSweep", "rebuilt", [&]() {
+            ExtendedCurves variants(0.001);
+            for (Size i = 0; i < grid.size(); ++i) {
+                variants.addOrUpdate(std::to_string(i), std::make_shared<ExtendedCurveWrapper>(
+                    built.front().second, std::make_from_tuple<LinearlyGraded<Traits::Forward>>(grid[i])));
+            }
+            variants.freeze();
+            for (Size i = 0; i < grid.size(); ++i) {
+                variants.setActiveCurve(std::to_string(i));
+                sink = sink + variants.NPV(leg) + variants.duration(leg) + variants.convexity(leg);
+                for (const auto& bond : bonds) {
+                    sink = sink + variants.NPV(bond) + variants.duration(bond) + variants.convexity(bond);
+                }
+            }
+        });
+
+        writeResults(options.out, runner.results());
+
+        int regressions = 0;
+        if (!options.baseline.empty()) {
+            regressions = compare(runner.results(), readResults(options.baseline), options.tolerance);
+        }
+        return regressions > 0 || failures > 0 ? 1 : 0;
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 2;
+    }
+}